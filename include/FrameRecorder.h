@@ -0,0 +1,49 @@
+//!
+//! @file  FrameRecorder.h
+//! @brief FrameRecorder クラス定義
+//!
+
+#pragma once
+
+#include <cstdio>
+
+#include "VideoSudoku.h"
+
+namespace videosudoku
+{
+//! @brief 画像ごとの処理結果を1行1レコードの JSON (NDJSON) で書き出すクラス
+//!
+//! レコードには画像の番号、時刻、処理した結果、前回の結果を使い回したかどうか、数独の輪郭の頂点、認識した初期値、解、処理の段階ごとの処理時間を含める。
+//! 画面表示を行わないヘッドレスモードで、処理結果を他のプログラムに渡すために使う。
+class FrameRecorder final
+{
+public:
+    //! @brief コンストラクタ
+    FrameRecorder() = default;
+
+    //! @brief デストラクタ
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+    //! @brief  出力先を開く
+    //! @param  file_name 出力ファイルのパス (nullptr の場合は標準出力)
+    //! @retval true  成功した場合
+    //! @retval false 失敗した場合
+    bool open(const char *file_name);
+
+    //! @brief 出力先を閉じる
+    void close();
+
+    //! @brief 1枚の画像の処理結果を書き出す
+    //! @param frame_index  画像の番号 (0 から)
+    //! @param timestamp_ms 画像を取得した時刻 (ms 処理の開始から)
+    //! @param video_sudoku 直前に solve を呼んだ VideoSudoku
+    void write(long frame_index, double timestamp_ms, const VideoSudoku &video_sudoku);
+
+private:
+    FILE *output = nullptr; //!< 出力先
+    bool owned = false;     //!< 出力先をこのオブジェクトで閉じるかどうか
+};
+}
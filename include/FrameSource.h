@@ -0,0 +1,89 @@
+//!
+//! @file  FrameSource.h
+//! @brief FrameSource 抽象クラス定義 ファクトリ定義
+//!
+
+#pragma once
+
+#include <chrono>
+
+#include <opencv2/core.hpp>
+
+namespace videosudoku
+{
+//! @brief 入力画像を取得する間隔
+enum FramePacing
+{
+    PACING_FAST = 0, //!< 待たずに次の画像を取得する (処理時間の計測用)
+    PACING_REALTIME  //!< 入力のフレームレートに合わせて待つ (録画した映像を実時間で再生する カメラデバイスは取得が既に実時間のため待たない)
+};
+
+//! @brief 入力画像を取得する抽象クラス
+//!
+//! カメラデバイス、動画ファイル、画像の連番、標準入力の生の画像データを同じ方法で読み出す。
+//! 画像は BGR の3チャンネルで取得する。
+class FrameSource
+{
+public:
+    //! @brief デストラクタ
+    virtual ~FrameSource() = default;
+
+    //! @brief  入力を開く
+    //! @param  location 入力の場所 (種類ごとの書式は frameSourceFactory を参照)
+    //! @retval true     成功
+    //! @retval false    失敗
+    virtual bool open(const char *location) = 0;
+
+    //! @brief 入力を閉じる
+    virtual void close() = 0;
+
+    //! @brief  画像のサイズを取得する
+    //! @return サイズ (分からない場合は 0x0)
+    virtual cv::Size frame_size() const = 0;
+
+    //! @brief  入力のフレームレートを取得する
+    //! @return フレームレート (fps 分からない場合は 0)
+    virtual double frame_rate() const = 0;
+
+    //! @brief  実時間で画像が届く入力かどうか (カメラデバイス)
+    //!
+    //! 実時間の入力は取得がデバイスのフレームレートで待つため、PACING_REALTIME でも待たない。
+    //! @retval true  実時間の入力
+    //! @retval false 録画した入力
+    virtual bool is_live() const { return false; }
+
+    //! @brief 画像を取得する間隔を設定する
+    //! @param pacing     取得する間隔
+    //! @param frame_rate PACING_REALTIME の場合に使うフレームレート (fps 0 以下の場合は入力のフレームレート)
+    void set_pacing(FramePacing pacing, double frame_rate = 0);
+
+    //! @brief  次の画像を取得する
+    //! @param  frame 取得先の画像 (サイズが同じであれば領域を再利用する)
+    //! @retval true  成功
+    //! @retval false 失敗 (入力の終わりを含む)
+    bool read(cv::Mat &frame);
+
+protected:
+    //! @brief  次の画像を待たずに取得する
+    //! @param  frame 取得先の画像
+    //! @retval true  成功
+    //! @retval false 失敗 (入力の終わりを含む)
+    virtual bool grab(cv::Mat &frame) = 0;
+
+private:
+    FramePacing pacing = PACING_FAST;                //!< 画像を取得する間隔
+    double pacing_rate = 0;                           //!< 指定されたフレームレート (fps)
+    std::chrono::steady_clock::time_point next_time;  //!< 次の画像を取得する時刻
+    bool started = false;                             //!< 最初の画像を取得したかどうか
+};
+
+//! @brief  入力画像を取得するインスタンスを生成して入力を開く
+//! @param  location 入力の場所
+//!                  ["camera:<id>" または "<id>": カメラデバイス,
+//!                   "video:<file>" または "<file>": 動画ファイル,
+//!                   "images:<directory または glob パターン>": 画像の連番 (ファイル名順),
+//!                   "stdin:<width>x<height>[:bgr|rgb|gray]": 標準入力から1枚ずつ読む生の画像データ (既定は bgr)]
+//! @retval nullptr  書式が正しくない 又は 入力を開けなかった
+//! @return others   生成したインスタンス
+FrameSource *frameSourceFactory(const char *location);
+}
@@ -0,0 +1,137 @@
+//!
+//! @file  LinearModel.h
+//! @brief LinearModel クラス定義 線形分類器のバイナリモデル形式定義
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MappedFile.h"
+
+namespace videosudoku
+{
+constexpr auto LINEAR_MAX_CLASS = 16; //!< 扱える分類クラス数の上限
+
+constexpr auto LINEAR_BINARY_VERSION = 1u; //!< 線形モデル形式のバージョン
+
+//! @brief 線形分類器の種類
+enum LinearModelType
+{
+    LINEAR_ONE_VS_ONE = 0,  //!< クラスの組ごとの決定関数で投票する (libsvm と同じ組の順序)
+    LINEAR_ONE_VS_REST = 1, //!< クラスごとのスコアの最大値を選ぶ (多項ロジスティック回帰など)
+};
+
+//! @brief 線形モデルのヘッダ
+//!
+//! ヘッダの後に各領域が 64 バイト境界に配置される。オフセットはファイル先頭からのバイト数。
+//! - label  : int32_t [nr_class]
+//! - bias   : float   [nr_function]
+//! - weight : float   [nr_function][stride] (stride 以降の要素は 0)
+struct linear_binary_header
+{
+    char magic[8];        //!< "VSLINBIN"
+    uint32_t version;     //!< LINEAR_BINARY_VERSION
+    uint32_t header_size; //!< sizeof(linear_binary_header)
+    uint64_t file_size;   //!< ファイル全体のサイズ
+
+    int32_t type;         //!< LinearModelType
+    int32_t nr_class;     //!< 分類クラス数
+    int32_t nr_function;  //!< 決定関数の数
+    int32_t image_rc;     //!< 入力画像の ROW, COL サイズ (特徴量の次元数は image_rc * image_rc)
+    int32_t dim;          //!< 特徴量の次元数
+    int32_t stride;       //!< 重み1本あたりの要素数 (VECTOR_BLOCK の倍数)
+
+    uint64_t label_offset;  //!< label のオフセット
+    uint64_t bias_offset;   //!< bias のオフセット
+    uint64_t weight_offset; //!< weight のオフセット
+};
+
+//! @brief 線形分類器のモデルを保持して推論するクラス
+//!
+//! SVMModel と同様に、ファイルをマップしてそのまま参照する。
+class LinearModel final
+{
+public:
+    //! @brief コンストラクタ
+    LinearModel() = default;
+
+    //! @brief デストラクタ
+    ~LinearModel();
+
+    LinearModel(const LinearModel &) = delete;
+    LinearModel &operator=(const LinearModel &) = delete;
+
+    //! @brief  線形モデルを読み込む
+    //! @param  file_name モデルファイル
+    //! @retval true      成功
+    //! @retval false     失敗
+    bool load(const char *file_name);
+
+    //! @brief  重みからモデルを作成する
+    //! @param  type        LinearModelType
+    //! @param  nr_class    分類クラス数
+    //! @param  labels      分類クラスのラベル (nr_class 要素)
+    //! @param  image_rc    入力画像の ROW, COL サイズ
+    //! @param  weights     重み (決定関数の数 * image_rc * image_rc 要素)
+    //! @param  biases      定数項 (決定関数の数 要素)
+    //! @retval true        成功
+    //! @retval false       失敗
+    bool assign(LinearModelType type, int nr_class, const int *labels, int image_rc, const double *weights, const double *biases);
+
+    //! @brief  線形モデルとして書き出す
+    //! @param  file_name 出力ファイル
+    //! @retval true      成功
+    //! @retval false     失敗
+    bool save(const char *file_name) const;
+
+    //! @brief モデルを解放する
+    void release();
+
+    //! @brief 分類クラス数
+    int get_nr_class() const { return header ? header->nr_class : 0; }
+
+    //! @brief 決定関数の数 (predict に渡す作業領域の長さ)
+    int get_nr_function() const { return header ? header->nr_function : 0; }
+
+    //! @brief 入力画像の ROW, COL サイズ
+    int get_image_rc() const { return header ? header->image_rc : 0; }
+
+    //! @brief 特徴量の要素数 (predict に渡す配列の長さ)
+    int get_stride() const { return header ? header->stride : 0; }
+
+    //! @brief 分類クラスのラベル
+    const int32_t *get_labels() const { return label; }
+
+    //! @brief  決定関数を評価して分類する
+    //! @param  x      特徴量 (get_stride() 要素 次元数以降は 0)
+    //! @param  scores 各決定関数の値 (get_nr_function() 要素)
+    //! @return 分類したラベル
+    int predict(const float *x, float *scores) const;
+
+    //! @brief 決定関数の値から各クラスの確度を求める
+    //!
+    //! one-vs-one は得票数 / (nr_class - 1)、one-vs-rest はスコアのソフトマックスを確度とする。
+    //! @param scores     predict で求めた決定関数の値
+    //! @param confidence 各クラスの確度 (nr_class 要素 ラベルの順)
+    void compute_confidence(const float *scores, double *confidence) const;
+
+private:
+    //! @brief  モデルイメージを検証して各領域を参照する
+    //! @param  image モデルイメージの先頭
+    //! @param  size  モデルイメージのサイズ
+    //! @retval true  成功
+    //! @retval false 不正なイメージ
+    bool bind(const unsigned char *image, std::size_t size);
+
+    MappedFile file; //!< 線形モデルのマップ
+
+    unsigned char *buffer = nullptr; //!< 作成したモデルのイメージ
+
+    const linear_binary_header *header = nullptr; //!< ヘッダ
+    const int32_t *label = nullptr;               //!< 分類クラスのラベル
+    const float *bias = nullptr;                  //!< 定数項
+    const float *weight = nullptr;                //!< 重み
+};
+}
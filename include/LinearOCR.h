@@ -0,0 +1,40 @@
+//!
+//! @file  LinearOCR.h
+//! @brief LinearOCR クラス定義
+//!
+
+#pragma once
+
+#include <memory>
+
+#include "LinearModel.h"
+#include "SudokuOCR.h"
+
+namespace videosudoku
+{
+//! @brief 縮小画像と線形分類器を利用して数字を認識するクラス
+//!
+//! SVMOCR より少し精度が落ちる代わりに、認識にかかる時間が大幅に短い。
+//! SVMOCR と同様に、モデルはインスタンスの間で共有し、作業領域は呼び出しごとに持つ。
+class LinearOCR final: public SudokuOCR
+{
+public:
+    virtual bool initialize(const char *file_name) override;
+    virtual int recognize_number(cv::Mat &mat) const override;
+    virtual int recognize_candidates(cv::Mat &mat, DigitCandidate *candidates, int max_candidates) const override;
+    virtual int recognize_candidates_at(cv::Mat &mat, const cv::Rect &digit_area, DigitCandidate *candidates, int max_candidates) const override;
+    virtual void finalize() override;
+
+    //! @brief 特徴量の計算 (画像から縮小画像の画素値への変換)
+    //!
+    //! 線形モデルを学習するツールも同じ特徴量を使うため、公開している。
+    //! @param mat        入力画像
+    //! @param digit_area 数字の領域 (空の場合は周囲の枠を除いた領域を使う)
+    //! @param image_rc   縮小画像の ROW, COL サイズ
+    //! @param x          LinearModel::predict への入力データ (image_rc * image_rc 要素)
+    static void compute_feature(cv::Mat &mat, const cv::Rect &digit_area, int image_rc, float *x);
+
+private:
+    std::shared_ptr<const LinearModel> model; //!< 共有する線形モデル
+};
+}
@@ -0,0 +1,48 @@
+//!
+//! @file  MappedFile.h
+//! @brief MappedFile クラス定義
+//!
+
+#pragma once
+
+#include <cstddef>
+
+namespace videosudoku
+{
+//! @brief ファイルを読み取り専用でメモリにマップするクラス
+//!
+//! マップしたページはプロセス間で共有されるため、同じファイルを開いた複数のプロセスは物理メモリを共有する。
+class MappedFile final
+{
+public:
+    //! @brief コンストラクタ
+    MappedFile() = default;
+
+    //! @brief デストラクタ
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    //! @brief  ファイルをマップする
+    //! @param  file_name ファイルのパス
+    //! @retval true      成功
+    //! @retval false     失敗
+    bool open(const char *file_name);
+
+    //! @brief マップを解除する
+    void close();
+
+    //! @brief  マップしたファイルの先頭アドレスを取得する
+    //! @return 先頭アドレス 開いていない場合は nullptr
+    const unsigned char *data() const { return address; }
+
+    //! @brief  マップしたファイルのサイズを取得する
+    //! @return ファイルのサイズ
+    std::size_t size() const { return length; }
+
+private:
+    const unsigned char *address = nullptr; //!< マップしたアドレス
+    std::size_t length = 0;                 //!< マップしたサイズ
+};
+}
@@ -0,0 +1,227 @@
+//!
+//! @file  SVMModel.h
+//! @brief SVMModel クラス定義 バイナリモデル形式定義
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <svm.h>
+
+#include "MappedFile.h"
+
+namespace videosudoku
+{
+constexpr auto SVM_MAX_CLASS = 16; //!< 扱える分類クラス数の上限
+
+constexpr auto SVM_BINARY_VERSION = 2u; //!< バイナリモデル形式のバージョン
+
+constexpr auto SVM_BINARY_ALIGN = 64u; //!< バイナリモデル内の各領域のアライメント (バイト)
+
+//! @brief バイナリモデルのヘッダ
+//!
+//! ヘッダの後に各領域が SVM_BINARY_ALIGN 境界に配置される。オフセットはファイル先頭からのバイト数。
+//! - label   : int32_t  [nr_class]
+//! - nsv     : int32_t  [nr_class]
+//! - rho     : double   [nr_class * (nr_class - 1) / 2]
+//! - probA   : double   [nr_class * (nr_class - 1) / 2] (確率モデルが無い場合はオフセット 0)
+//! - probB   : double   [nr_class * (nr_class - 1) / 2] (確率モデルが無い場合はオフセット 0)
+//! - sv_coef : double   [nr_class - 1][total_sv]
+//! - sv      : float    [total_sv][stride] (密な形式 stride 以降の要素は 0)
+//! - projection      : float [dim][input_stride] (射影しない場合はオフセット 0 input_stride = vector_stride(input_dim))
+//! - projection_bias : float [dim]               (射影しない場合はオフセット 0)
+struct svm_binary_header
+{
+    char magic[8];          //!< "VSSVMBIN"
+    uint32_t version;       //!< SVM_BINARY_VERSION
+    uint32_t header_size;   //!< sizeof(svm_binary_header)
+    uint64_t file_size;     //!< ファイル全体のサイズ
+
+    int32_t svm_type;       //!< libsvm の svm_type (C_SVC, NU_SVC のみ)
+    int32_t kernel_type;    //!< libsvm の kernel_type
+    int32_t degree;         //!< POLY カーネルの次数
+    int32_t nr_class;       //!< 分類クラス数
+    double gamma;           //!< カーネルパラメータ gamma
+    double coef0;           //!< カーネルパラメータ coef0
+
+    int32_t total_sv;       //!< サポートベクタの総数
+    int32_t dim;            //!< 特徴量の次元数
+    int32_t stride;         //!< サポートベクタ1本あたりの要素数 (VECTOR_BLOCK の倍数)
+    int32_t input_dim;      //!< 射影前の特徴量の次元数 (射影しない場合は 0)
+
+    uint64_t label_offset;   //!< label のオフセット
+    uint64_t nsv_offset;     //!< nsv のオフセット
+    uint64_t rho_offset;     //!< rho のオフセット
+    uint64_t prob_a_offset;  //!< probA のオフセット
+    uint64_t prob_b_offset;  //!< probB のオフセット
+    uint64_t sv_coef_offset; //!< sv_coef のオフセット
+    uint64_t sv_offset;      //!< sv のオフセット
+
+    uint64_t projection_offset;      //!< projection のオフセット
+    uint64_t projection_bias_offset; //!< projection_bias のオフセット
+};
+
+//! @brief 密なサポートベクタを持つ SVM モデルを保持して推論するクラス
+//!
+//! バイナリモデルはファイルをマップしてそのまま参照するため、読み込み時に解析やメモリ確保を行わない。
+//! libsvm のモデルから変換した場合は同じ形式のイメージをメモリ上に作成する。
+//! 射影を持つモデルは、入力を PCA などで低次元に射影した空間でカーネルを評価する。
+class SVMModel final
+{
+public:
+    //! @brief コンストラクタ
+    SVMModel() = default;
+
+    //! @brief デストラクタ
+    ~SVMModel();
+
+    SVMModel(const SVMModel &) = delete;
+    SVMModel &operator=(const SVMModel &) = delete;
+
+    //! @brief  バイナリモデルを読み込む
+    //! @param  file_name モデルファイル
+    //! @retval true      成功
+    //! @retval false     失敗 (バイナリモデルでない場合を含む)
+    bool load(const char *file_name);
+
+    //! @brief  libsvm のモデルから変換する
+    //!
+    //! 射影を与えた場合、射影後の特徴量は x[k] = projection_weights[k] * input + projection_biases[k] とする。
+    //! @param  model              変換元のモデル (射影後の特徴量で学習したもの)
+    //! @param  dim                特徴量の次元数 (射影する場合は射影後の次元数)
+    //! @param  input_dim          射影前の特徴量の次元数 (0 の場合は射影しない)
+    //! @param  projection_weights 射影行列 (dim * input_dim 要素 行優先)
+    //! @param  projection_biases  射影後の定数項 (dim 要素)
+    //! @retval true               成功
+    //! @retval false              失敗
+    bool assign(const svm_model *model, int dim, int input_dim = 0, const double *projection_weights = nullptr, const double *projection_biases = nullptr);
+
+    //! @brief  バイナリモデルとして書き出す
+    //! @param  file_name 出力ファイル
+    //! @retval true      成功
+    //! @retval false     失敗
+    bool save(const char *file_name) const;
+
+    //! @brief モデルを解放する
+    void release();
+
+    //! @brief 分類クラス数
+    int get_nr_class() const { return header ? header->nr_class : 0; }
+
+    //! @brief 特徴量の次元数 (射影する場合は射影後の次元数)
+    int get_dim() const { return header ? header->dim : 0; }
+
+    //! @brief 入力の次元数 (射影しない場合は get_dim() と同じ)
+    int get_input_dim() const { return header ? (header->input_dim ? header->input_dim : header->dim) : 0; }
+
+    //! @brief 入力の要素数 (project に渡す配列の長さ)
+    int get_input_stride() const { return header ? (header->input_dim ? projection_stride : header->stride) : 0; }
+
+    //! @brief 特徴量の要素数 (predict* に渡す配列の長さ)
+    int get_stride() const { return header ? header->stride : 0; }
+
+    //! @brief サポートベクタの総数 (predict* に渡す作業領域の長さ)
+    int get_total_sv() const { return header ? header->total_sv : 0; }
+
+    //! @brief 分類クラスのラベル
+    const int32_t *get_labels() const { return label; }
+
+    //! @brief 確率モデルを持っているかどうか
+    bool has_probability() const { return prob_a && prob_b; }
+
+    //! @brief 射影を持っているかどうか (predict* の前に project が必要)
+    bool has_projection() const { return projection != nullptr; }
+
+    //! @brief 入力を特徴量の空間に射影する
+    //! @param input 入力 (get_input_stride() 要素 次元数以降は 0)
+    //! @param x     特徴量 (get_stride() 要素 次元数以降は 0 になる)
+    void project(const float *input, float *x) const;
+
+    //! @brief  決定値を計算して分類する
+    //! @param  x          特徴量 (get_stride() 要素 次元数以降は 0)
+    //! @param  kvalue     作業領域 (get_total_sv() 要素)
+    //! @param  dec_values 決定値 (nr_class * (nr_class - 1) / 2 要素)
+    //! @return 分類したラベル
+    int predict_values(const float *x, double *kvalue, double *dec_values) const;
+
+    //! @brief  確率を推定して分類する
+    //! @param  x           特徴量 (get_stride() 要素 次元数以降は 0)
+    //! @param  kvalue      作業領域 (get_total_sv() 要素)
+    //! @param  probability 各クラスの確率 (nr_class 要素 ラベルの順)
+    //! @return 分類したラベル
+    int predict_probability(const float *x, double *kvalue, double *probability) const;
+
+    //! @brief  決定値から確率を推定して分類する
+    //!
+    //! 確率モデルを持たない場合は得票数の割合を確率とする。
+    //! @param  dec_values  predict_values で求めた決定値
+    //! @param  probability 各クラスの確率 (nr_class 要素 ラベルの順)
+    //! @return 分類したラベル
+    int probability_from_values(const double *dec_values, double *probability) const;
+
+    //! @brief  決定値から勝者のクラスの余裕を求める
+    //!
+    //! 勝者が関わるすべての組の決定値を勝者の側に符号を揃えたうちの最小値を返す。
+    //! 正であれば勝者はすべての組で勝っている (全会一致) 。
+    //! @param  dec_values   predict_values で求めた決定値
+    //! @param  winner_index 勝者のクラスの index (ラベルの順)
+    //! @return 余裕
+    double winner_margin(const double *dec_values, int winner_index) const;
+
+    //! @brief 勝者が明らかな場合に、勝者の関わる組の確率だけから各クラスの確率を近似する
+    //!
+    //! 勝者以外のクラスはそのクラスが勝者に勝つ確率、勝者はすべての組で勝つ確率の最小値とし、合計が1になるように正規化する。
+    //! 反復計算を行う probability_from_values よりも大幅に軽い。
+    //! @param dec_values   predict_values で求めた決定値
+    //! @param winner_index 勝者のクラスの index (ラベルの順)
+    //! @param probability  各クラスの確率 (nr_class 要素 ラベルの順)
+    void approximate_probability(const double *dec_values, int winner_index, double *probability) const;
+
+    //! @brief  ラベルに対応するクラスの index を求める
+    //! @param  label ラベル
+    //! @retval -1    ラベルが存在しない
+    //! @return others クラスの index
+    int label_index(int label) const;
+
+private:
+    //! @brief  モデルイメージを検証して各領域を参照する
+    //! @param  image モデルイメージの先頭
+    //! @param  size  モデルイメージのサイズ
+    //! @retval true  成功
+    //! @retval false 不正なイメージ
+    bool bind(const unsigned char *image, std::size_t size);
+
+    //! @brief  組 (i, j) の決定値の index を求める (i < j libsvm と同じ順序)
+    //! @param  i クラスの index
+    //! @param  j クラスの index
+    //! @return 決定値の index
+    int pair_index(int i, int j) const;
+
+    //! @brief カーネル値を計算する
+    //! @param x      特徴量
+    //! @param kvalue カーネル値
+    void compute_kernel(const float *x, double *kvalue) const;
+
+    MappedFile file; //!< バイナリモデルのマップ
+
+    unsigned char *buffer = nullptr; //!< 変換したモデルのイメージ
+    std::size_t buffer_size = 0;     //!< 変換したモデルのイメージのサイズ
+
+    const svm_binary_header *header = nullptr; //!< ヘッダ
+    const int32_t *label = nullptr;            //!< 分類クラスのラベル
+    const int32_t *nsv = nullptr;              //!< クラスごとのサポートベクタ数
+    const double *rho = nullptr;               //!< 決定関数の定数項
+    const double *prob_a = nullptr;            //!< 確率モデルのパラメータA
+    const double *prob_b = nullptr;            //!< 確率モデルのパラメータB
+    const double *sv_coef = nullptr;           //!< サポートベクタの係数
+    const float *sv = nullptr;                 //!< サポートベクタ
+    const float *projection = nullptr;         //!< 射影行列
+    const float *projection_bias = nullptr;    //!< 射影後の定数項
+
+    int projection_stride = 0; //!< 射影行列の1行あたりの要素数
+
+    int start[SVM_MAX_CLASS] = {0}; //!< クラスごとのサポートベクタの開始位置
+};
+}
@@ -5,9 +5,11 @@
 
 #pragma once
 
-#include <svm.h>
+#include <memory>
 
+#include "SVMModel.h"
 #include "SudokuOCR.h"
+#include "vecmath.h"
 
 namespace videosudoku
 {
@@ -15,41 +17,53 @@ constexpr auto IMAGE_RC = 30; //!< 認識画像のROW, COLサイズ
 
 constexpr auto DATA_RC = IMAGE_RC;            //!< 認識データのROW, COLサイズ
 constexpr auto DATA_SIZE = DATA_RC * DATA_RC; //!< 認識データのサイズ
+constexpr auto DATA_STRIDE = vector_stride(DATA_SIZE); //!< SVMModel への入力データの要素数
 
 constexpr auto NR_CLASS = 10; //!< 分類クラス (' ' と '1' - '9' の 10種)
+constexpr auto NR_PAIR = NR_CLASS * (NR_CLASS - 1) / 2; //!< one-vs-one の決定関数の数
+
+constexpr auto DEFAULT_PROBABILITY_MARGIN = 0.5; //!< 確率の推定を省く決定値の余裕の既定値
 
 //! @brief SVMを利用して数字を認識するクラス
+//!
+//! モデルは同じファイルを使うインスタンスの間で共有し (share_model)、作業領域は呼び出しごとに持つ。
+//! 射影を持つモデルの場合は、認識データを低次元に射影してからカーネルを評価する。
 class SVMOCR final: public SudokuOCR
 {
 public:
     virtual bool initialize(const char *file_name) override;
-    virtual int recognize_number(cv::Mat &mat) override;
+    virtual int recognize_number(cv::Mat &mat) const override;
+    virtual int recognize_candidates(cv::Mat &mat, DigitCandidate *candidates, int max_candidates) const override;
+    virtual int recognize_candidates_at(cv::Mat &mat, const cv::Rect &digit_area, DigitCandidate *candidates, int max_candidates) const override;
     virtual void finalize() override;
 
-private:
+    //! @brief 確率の推定を省く決定値の余裕を設定する
+    //!
+    //! 勝者がすべての組でこの値以上の決定値で勝っている場合は、反復計算による確率の推定を省き、
+    //! 勝者の関わる組の確率から近似する。負の値を設定すると常に確率を推定する。
+    //! @param margin 決定値の余裕
+    void set_probability_margin(double margin) { probability_margin = margin; }
+
     //! @brief 特徴量の計算 (画像から認識データへの変換)
-    //! @param mat  入力画像
-    //! @param data 認識データ
-    void compute_feature(cv::Mat &mat, unsigned char *data) const;
+    //!
+    //! モデルを学習するツールも同じ特徴量を使うため、公開している。
+    //! @param mat        入力画像
+    //! @param digit_area 数字の領域 (空の場合は周囲の枠を除いた領域を使う)
+    //! @param data       認識データ (DATA_SIZE 要素)
+    static void compute_feature(cv::Mat &mat, const cv::Rect &digit_area, unsigned char *data);
 
-    //! @brief 正規化 (高さによる正規化)
-    //! @param src 入力画像
-    //! @param dst 変換画像
-    void normalize(const cv::Mat &src, cv::Mat &dst) const;
+private:
 
     //! @brief  認識処理
-    //! @param  data 認識データ
-    //! @retval 1-9  認識した数値
-    //! @retval 0    空白
-    int predict(unsigned char *data);
-
-    svm_model *model = nullptr; //!< libsvm のモデル
-
-    unsigned char data[DATA_SIZE] = {0}; //!< 認識用データ
+    //! @param  data        認識データ
+    //! @param  probability 各クラスの確度 (NR_CLASS 要素 モデルのラベルの順)
+    //! @retval 1-9         認識した数値
+    //! @retval 0           空白
+    int predict(const unsigned char *data, double *probability) const;
 
-    svm_node x[DATA_SIZE + 1];      //!< svm_predict* への入力データ
+    std::shared_ptr<const SVMModel> model; //!< 共有する密な形式の SVM モデル
 
-    double probability[NR_CLASS] = {0}; //!< 確度
+    double probability_margin = DEFAULT_PROBABILITY_MARGIN; //!< 確率の推定を省く決定値の余裕
     int label_to_index[NR_CLASS] = {0}; //!< label から probability の index への変換テーブル
 };
 }
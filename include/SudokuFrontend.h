@@ -0,0 +1,69 @@
+//!
+//! @file  SudokuFrontend.h
+//! @brief SudokuFrontend クラス定義
+//!
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "FrameSource.h"
+#include "VideoSudoku.h"
+
+namespace videosudoku
+{
+//! @brief アプリケーションの入力画像の取得と画面表示を行うクラス
+//!
+//! 数独を解く処理は VideoSudoku に任せ、カメラデバイスなどの入力と HighGUI のウィンドウだけを持つ。
+//! 取得と表示の処理時間は VideoSudoku の統計に記録する。
+class SudokuFrontend final
+{
+public:
+    //! @brief コンストラクタ
+    //! @param video_sudoku 処理時間を記録する VideoSudoku
+    explicit SudokuFrontend(VideoSudoku &video_sudoku);
+
+    //! @brief デストラクタ
+    ~SudokuFrontend();
+
+    SudokuFrontend(const SudokuFrontend &) = delete;
+    SudokuFrontend &operator=(const SudokuFrontend &) = delete;
+
+    //! @brief  入力を開く
+    //! @param  location 入力の場所 (frameSourceFactory に渡す文字列)
+    //! @retval true  成功
+    //! @retval false 失敗
+    bool open(const char *location);
+
+    //! @brief 入力を閉じる
+    void close();
+
+    //! @brief 入力画像を取得する間隔を設定する
+    //! @param pacing     取得する間隔
+    //! @param frame_rate PACING_REALTIME の場合に使うフレームレート (fps 0 以下の場合は入力のフレームレート)
+    void set_pacing(FramePacing pacing, double frame_rate = 0);
+
+    //! @brief 入力画像のサイズ (分からない場合は 0x0)
+    cv::Size get_frame_size() const;
+
+    //! @brief  ビデオ入力を指定した画像に取得する
+    //! @param  frame 取得先の画像 (サイズが同じであれば領域を再利用する)
+    //! @retval true  成功
+    //! @retval false 失敗 (入力の終わりを含む)
+    bool capture_video(cv::Mat &frame);
+
+    //! @brief 指定した画像を画面表示する (パイプラインの表示段用)
+    //! @param frame          入力画像 (輪郭線と重ねる数字を書き込む)
+    //! @param frame_contours 数独ごとの輪郭 (空の場合は描かない)
+    //! @param result         結果画像 (nullptr の場合は結果画像の表示を更新しない)
+    //! @param overlays       入力画像に重ねる解 (nullptr の場合は重ねない)
+    void display(cv::Mat &frame, const std::vector<std::vector<cv::Point>> &frame_contours, const cv::Mat *result, const std::vector<SudokuOverlay> *overlays = nullptr);
+
+private:
+    VideoSudoku &video_sudoku; //!< 処理時間を記録するオブジェクト
+
+    FrameSource *source = nullptr; //!< 入力画像を取得するオブジェクト
+};
+}
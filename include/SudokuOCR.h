@@ -5,11 +5,24 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <opencv2/core.hpp>
 
 namespace videosudoku
 {
+//! @brief 数字の認識候補
+struct DigitCandidate
+{
+    int number;        //!< 1-9 認識した数値 0 空白
+    double confidence; //!< 確度 (0-1)
+};
+
 //! @brief 数字を認識する抽象クラス
+//!
+//! initialize の後の認識処理は const で作業領域を呼び出しごとに持つため、
+//! 1つのインスタンスを複数のスレッドから同時に呼び出せる。
 class SudokuOCR
 {
 public:
@@ -26,14 +39,50 @@ public:
     //! @param  mat 認識対象画像
     //! @retval 1-9 認識した数値
     //! @retval 0   空白
-    virtual int recognize_number(cv::Mat &mat) = 0;
+    virtual int recognize_number(cv::Mat &mat) const = 0;
+
+    //! @brief  確度の高い順に認識候補を求める
+    //!
+    //! 既定の実装は recognize_number の結果を確度 1 の唯一の候補とする。
+    //! @param  mat            認識対象画像
+    //! @param  candidates     認識候補 (確度の降順)
+    //! @param  max_candidates 求める候補の最大数 (1 以上)
+    //! @return 求めた候補の数
+    virtual int recognize_candidates(cv::Mat &mat, DigitCandidate *candidates, int max_candidates) const;
+
+    //! @brief  数字の領域が分かっている場合に、確度の高い順に認識候補を求める
+    //!
+    //! 呼び出し側で盤面全体から数字の領域を求めてある場合に、マスごとの領域の探索を省く。
+    //! 既定の実装は digit_area を使わずに recognize_candidates を呼ぶ。
+    //! @param  mat            認識対象画像
+    //! @param  digit_area     数字の領域 (mat の座標系 空の場合は数字が見つからなかったことを表す)
+    //! @param  candidates     認識候補 (確度の降順)
+    //! @param  max_candidates 求める候補の最大数 (1 以上)
+    //! @return 求めた候補の数
+    virtual int recognize_candidates_at(cv::Mat &mat, const cv::Rect &digit_area, DigitCandidate *candidates, int max_candidates) const;
 
     //! @brief 終了処理
     virtual void finalize() = 0;
 };
 
+//! @brief 数字を認識するインスタンスの生成関数型
+typedef SudokuOCR *(*SudokuOCRCreator)();
+
+//! @brief  数字を認識するクラスを登録する
+//! @param  class_name 登録するクラス名
+//! @param  creator    インスタンスの生成関数
+//! @retval true       成功
+//! @retval false      既に同じ名前で登録されている
+bool registerSudokuOCR(const char *class_name, SudokuOCRCreator creator);
+
+//! @brief  登録されているクラス名の一覧を取得する
+//! @return クラス名の一覧
+std::vector<std::string> sudokuOCRNames();
+
 //! @brief  数字を認識するインスタンスを生成する
-//! @param  class_name 生成するクラス名 ["SVMOCR": SVMを利用したクラス]
-//! @return 生成したインスタンス
+//! @param  class_name 生成するクラス名 nullptr の場合は "SVMOCR"
+//!                    ["SVMOCR": SVMを利用したクラス, "LinearOCR": 縮小画像と線形分類器を利用した軽量なクラス]
+//! @retval nullptr    登録されていないクラス名
+//! @return others     生成したインスタンス
 SudokuOCR *sudokuOCRFactory(const char *class_name);
 }
\ No newline at end of file
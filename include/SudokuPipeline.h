@@ -0,0 +1,92 @@
+//!
+//! @file  SudokuPipeline.h
+//! @brief SudokuPipeline クラス定義
+//!
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "spsc_queue.h"
+#include "SudokuFrontend.h"
+#include "VideoSudoku.h"
+
+namespace videosudoku
+{
+//! @brief 入力、処理、表示の各段を別々のスレッドで動かすクラス
+//!
+//! 入力段は取得した画像を処理段と表示段のキューに渡し、処理段は数独を解いた結果を表示段のキューに渡す。
+//! 表示段は呼び出し元のスレッド (HighGUI を使うメインスレッド) で動き、最新の入力画像に最新の結果を重ねて表示する。
+//! 各段は固定長のキューでつながっており、キューが満杯の場合はその画像を捨てるため、
+//! 表示のフレームレートは数独を解く時間に左右されない。
+class SudokuPipeline final
+{
+public:
+    //! @brief コンストラクタ
+    //! @param video_sudoku 初期化済みの VideoSudoku (パイプラインの動作中は他から使わない)
+    //! @param frontend     入力を開いた SudokuFrontend (パイプラインの動作中は他から使わない)
+    SudokuPipeline(VideoSudoku &video_sudoku, SudokuFrontend &frontend);
+
+    //! @brief デストラクタ
+    ~SudokuPipeline();
+
+    SudokuPipeline(const SudokuPipeline &) = delete;
+    SudokuPipeline &operator=(const SudokuPipeline &) = delete;
+
+    //! @brief 入力段と処理段のスレッドを開始する
+    void start();
+
+    //! @brief 入力段と処理段のスレッドを停止する
+    void stop();
+
+    //! @brief  表示段: 新しい入力画像と結果があれば画面表示する
+    //! @retval true  動作中
+    //! @retval false 入力が終わった
+    bool display();
+
+    //! @brief 画面表示の固定を切り替える (固定中は新しい画像を取り込まない)
+    //! @param holding 固定する場合:true 解除する場合:false
+    void set_holding(bool holding) { state_holding = holding; }
+
+    //! @brief  文字認識の準備状況を調べる (VideoSudoku::ocr_status と同じ値)
+    //! @return 準備状況
+    int ocr_status() const { return ocr_state; }
+
+private:
+    //! @brief 処理段から表示段に渡す結果
+    struct ProcessedFrame
+    {
+        cv::Mat result;                               //!< 結果画像
+        std::vector<std::vector<cv::Point>> contours; //!< 数独ごとの輪郭 (見つからなかった場合は空)
+        std::vector<SudokuOverlay> overlays;          //!< 入力画像に重ねる解 (重ねない場合は空)
+    };
+
+    //! @brief 入力段のスレッド
+    void capture_loop();
+
+    //! @brief 処理段のスレッド
+    void process_loop();
+
+    VideoSudoku &video_sudoku; //!< 数独を解くオブジェクト
+    SudokuFrontend &frontend;  //!< 入力と画面表示を行うオブジェクト
+
+    SPSCQueue<cv::Mat> process_queue;        //!< 入力段から処理段への画像
+    SPSCQueue<cv::Mat> display_queue;        //!< 入力段から表示段への画像
+    SPSCQueue<ProcessedFrame> result_queue;  //!< 処理段から表示段への結果
+
+    std::vector<std::vector<cv::Point>> display_contours; //!< 表示段が重ねる最新の輪郭
+    std::vector<SudokuOverlay> display_overlays;          //!< 表示段が重ねる最新の解
+
+    std::atomic<bool> running{false};       //!< スレッドを動かすかどうか
+    std::atomic<bool> capturing{false};     //!< 入力が続いているかどうか
+    std::atomic<bool> state_holding{false}; //!< 画面表示を固定しているかどうか
+    std::atomic<int> ocr_state{1};          //!< 文字認識の準備状況
+
+    std::thread capture_thread; //!< 入力段のスレッド
+    std::thread process_thread; //!< 処理段のスレッド
+};
+}
@@ -9,15 +9,58 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <opencv2/core.hpp>
-#include <opencv2/videoio.hpp>
 
 #include "debuglog.h"
+#include "digit_image.h"
+#include "mean_threshold.h"
+#include "stage_statistics.h"
 #include "SudokuOCR.h"
+#include "worker_pool.h"
 
 namespace videosudoku
 {
-//! @brief カメラからの入力画像から数独を検出して、その解をリアルタイムに表示するクラス
+constexpr auto DEFAULT_GATE_THRESHOLD = 2.0; //!< 変化とみなす縮小画像の画素値の差の平均の既定値
+constexpr auto DEFAULT_GATE_REFRESH = 30;    //!< 変化が無くても処理し直すまでに省く画像の数の既定値
+
+//! @brief 呼び出し元が渡す画像の画素の形式
+enum PixelFormat
+{
+    PIXEL_BGR24 = 0, //!< 8bit 3チャンネル (B G R の順 OpenCV のカメラ入力と同じ)
+    PIXEL_RGB24,     //!< 8bit 3チャンネル (R G B の順)
+    PIXEL_BGRA32,    //!< 8bit 4チャンネル (B G R A の順)
+    PIXEL_RGBA32,    //!< 8bit 4チャンネル (R G B A の順)
+    PIXEL_GRAY8      //!< 8bit 1チャンネル (グレースケール)
+};
+
+//! @brief 呼び出し元に返す1つの数独の結果
+struct SudokuAnswer
+{
+    SudokuOutcome outcome = OUTCOME_NOT_READY; //!< 結果 (OUTCOME_FEW_GIVENS 以降)
+    cv::Point corners[4];                      //!< 数独の輪郭の頂点 (入力画像の座標系)
+    char grid[82] = {0};                       //!< 認識した初期値 (81文字 空白は0 結果が OUTCOME_UNSOLVABLE 以降の場合に有効 それ以外は空文字列)
+    char solution[82] = {0};                   //!< 数独の解 (81文字 結果が OUTCOME_SOLVED の場合に有効 それ以外は空文字列)
+};
+
+//! @brief 入力画像に重ねて表示する1つの数独の解
+struct SudokuOverlay
+{
+    std::vector<cv::Point> contour; //!< 数独の輪郭 (入力画像の座標系)
+    cv::Mat digits;                 //!< 解いた数字を歪み補正した盤面の座標系で描いた画像 (結果画像の一辺の長さの正方形)
+    cv::Mat mask;                   //!< digits の数字を描いた画素 (0以外)
+};
+
+//! @brief 入力画像から数独を検出して解き、その解を結果画像に描くクラス
+//!
+//! 入力画像の取得と画面表示は行わない (アプリケーションでは SudokuFrontend が行う)。
 class VideoSudoku final
 {
 public:
@@ -28,99 +71,356 @@ public:
     ~VideoSudoku();
 
     //! @brief  初期化処理
-    //! @param  size      結果画像のサイズ
-    //! @parem  device_id 使用するカメラデバイスのID
-    //! @retval 0         正常終了
-    //! @retval 1         カメラデバイスを開けなかった
-    //! @retval 2         文字認識オブジェクトの初期化失敗
-    //! @retval 3         モデルデータの読み込み失敗
-    int initialize(int size, int device_id);
+    //!
+    //! モデルデータの読み込みはバックグラウンドで行い、完了を待たずに戻る。
+    //! 読み込みの間も入力画像は表示でき、読み込みが終わると solve が数独を解き始める。
+    //! 読み込みの結果は ocr_status で調べる。
+    //! 入力画像の取得と画面表示は行わないため、呼び出し元が取得した画像を solve に渡す。
+    //! @param  size       結果画像のサイズ
+    //! @param  ocr_name   文字認識オブジェクトの種類 (sudokuOCRFactory に渡す名前 nullptr の場合は既定の種類)
+    //! @param  model_file 文字認識に使うモデルデータのパス (nullptr の場合は文字認識オブジェクトの既定のモデル)
+    //! @retval 0          正常終了
+    //! @retval 1          文字認識オブジェクトの初期化失敗
+    int initialize(int size, const char *ocr_name = nullptr, const char *model_file = nullptr);
+
+    //! @brief 変化の無い画像で処理を省く条件を設定する
+    //!
+    //! 入力画像の縮小画像を最後に処理した画像の縮小画像と比べ、変化が小さければ輪郭の抽出、文字認識、数独を解く処理を省いて前回の結果を使う。
+    //! @param change_threshold 変化とみなす縮小画像の画素値の差の平均 (0 以下の場合は省かない)
+    //! @param refresh_interval 変化が無くても処理し直すまでに省く画像の数
+    void set_gating(double change_threshold, int refresh_interval);
+
+    //! @brief 解いた数字を入力画像の数独の上に重ねて表示するかどうかを設定する (solve を呼ぶ前に設定する)
+    //!
+    //! 解いた数字は歪み補正した盤面の座標系で解が変わったときにだけ描き、表示のたびに数独の領域だけを入力画像に射影して重ねる。
+    //! @param enabled 重ねる場合:true 重ねない場合:false (既定)
+    void set_overlay(bool enabled) { overlay = enabled; }
+
+    //! @brief 解いた数字を入力画像に重ねて表示するかどうか
+    bool is_overlay_enabled() const { return overlay; }
 
     //! @brief 終了処理
     void finalize();
 
-    //! @brief  ビデオ入力を取得
-    //! @retval true  成功
-    //! @retval false 失敗
-    bool capture_video();
+    //! @brief  文字認識の準備状況を調べる
+    //! @retval 0 準備完了
+    //! @retval 1 モデルデータの読み込み中
+    //! @retval 2 初期化されていない
+    //! @retval 3 モデルデータの読み込み失敗
+    int ocr_status();
 
-    //! @brief 画面表示
-    //! @param results_availability 結果を表示する場合:true 表示しない場合:false
-    void display(bool results_availability);
+    //! @brief  モデルデータの読み込みが終わるまで待つ
+    //! @return ocr_status と同じ値 (読み込み中を除く)
+    int wait_ocr();
 
-    //! @brief  画像中の数独を解く
-    //! @retval true  数独を解けた
+    //! @brief 入力画像に数独の輪郭線と解いた数字を書き込む (表示段用 画面表示は呼び出し元で行う)
+    //! @param frame          入力画像
+    //! @param frame_contours 数独ごとの輪郭 (空の場合は描かない)
+    //! @param overlays       入力画像に重ねる解 (nullptr の場合は重ねない)
+    void annotate(cv::Mat &frame, const std::vector<std::vector<cv::Point>> &frame_contours, const std::vector<SudokuOverlay> *overlays = nullptr);
+
+    //! @brief 呼び出し元で計測した段階の処理時間を記録する (入力画像の取得と画面表示用)
+    //! @param stage   処理の段階
+    //! @param time_us 処理時間 (us)
+    void record_stage(SudokuStage stage, double time_us);
+
+    //! @brief  指定した画像中の数独を解く
+    //!
+    //! 画像中に複数の数独がある場合は、それぞれの盤面の歪み補正、文字認識、数独を解く処理を並列に行う。
+    //! 実行した段階の処理時間と結果は統計に記録する。
+    //! @param  frame 入力画像 (BGR の3チャンネル 複製せずに参照する)
+    //! @retval true  1つ以上の数独を解けた
     //! @retval false 数独を解けなかった
-    bool solve();
+    bool solve(const cv::Mat &frame);
+
+    //! @brief  呼び出し元の画素の領域を複製せずに参照して、画像中の数独を解く (ライブラリとして組み込む場合用)
+    //!
+    //! 画素の領域は呼び出しの間だけ参照し、書き換えない。文字認識の準備ができるまでは解かないため、最初に wait_ocr で待つ。
+    //! @param  pixels  先頭の画素
+    //! @param  width   幅 (px)
+    //! @param  height  高さ (px)
+    //! @param  stride  1行のバイト数 (0 の場合は幅と画素の形式から求める)
+    //! @param  format  画素の形式
+    //! @param  answers 見つけた数独ごとの結果の書き出し先 (面積の大きい順 見つからなかった場合は空)
+    //! @retval true  1つ以上の数独を解けた
+    //! @retval false 数独を解けなかった (画像の指定が正しくない場合を含む)
+    bool solve(const unsigned char *pixels, int width, int height, std::size_t stride, PixelFormat format, std::vector<SudokuAnswer> &answers);
+
+    //! @brief 直前の solve で見つけた数独ごとの結果を書き出す
+    //! @param answers 書き出し先 (面積の大きい順 見つからなかった場合は空)
+    void export_answers(std::vector<SudokuAnswer> &answers) const;
+
+    //! @brief 直前の solve の結果を書き出す (パイプラインの処理段から表示段に渡す)
+    //! @param results_availability 結果を更新する場合:true 前回の結果のままにする場合:false
+    //! @param result               結果画像の書き出し先 (盤面ごとの結果を横に並べる サイズが同じであれば領域を再利用する)
+    //! @param frame_contours       数独ごとの輪郭の書き出し先 (数独が見つからなかった場合は空)
+    void export_result(bool results_availability, cv::Mat &result, std::vector<std::vector<cv::Point>> &frame_contours);
+
+    //! @brief 直前の solve で解けた数独の、入力画像に重ねる解を書き出す (パイプラインの処理段から表示段に渡す)
+    //! @param overlays 書き出し先 (解けた数独ごと 要素の領域は再利用する set_overlay で有効にしていない場合は空)
+    void export_overlays(std::vector<SudokuOverlay> &overlays) const;
+
+    //! @brief 結果画像の一辺の長さ
+    int get_result_size() const { return result_size; }
+
+    //! @brief 直前の solve の結果 (複数の数独がある場合は最も先の段階まで進んだ結果)
+    SudokuOutcome get_outcome() const { return outcome; }
+
+    //! @brief 直前の solve で見つけた数独の数
+    int get_grid_count() const { return grid_count; }
+
+    //! @brief  直前の solve で見つけた数独ごとの結果
+    //! @param  index 数独の番号 (0 から get_grid_count() - 1 面積の大きい順)
+    //! @return 結果
+    SudokuOutcome get_grid_outcome(int index) const { return grids[static_cast<size_t>(index)].outcome; }
+
+    //! @brief 直前の solve が変化の無い画像として前回の結果を使い回したかどうか
+    bool is_result_reused() const { return reused_result; }
+
+    //! @brief 直前の solve で抽出した数独の輪郭 (数独の結果が OUTCOME_FEW_GIVENS 以降の場合に有効)
+    const std::vector<cv::Point> &get_contour(int index = 0) const { return grids[static_cast<size_t>(index)].contour; }
+
+    //! @brief 直前の solve で認識した数独の初期値 (数独の結果が OUTCOME_UNSOLVABLE 以降の場合に有効 81文字)
+    const char *get_input_problem(int index = 0) const { return grids[static_cast<size_t>(index)].input_problem.data(); }
+
+    //! @brief 直前の solve で求めた数独の解 (数独の結果が OUTCOME_SOLVED の場合に有効 81文字)
+    const char *get_result_problem(int index = 0) const { return grids[static_cast<size_t>(index)].result_problem.data(); }
+
+    //! @brief 直前の処理の段階ごとの処理時間 (us STAGE_NUMBER 要素 実行しなかった段階は 0)
+    const double *get_stage_times() const { return stage_times; }
+
+    //! @brief 段階ごとの処理時間の直近の百分位数と、結果の種類ごとの回数の統計
+    const StageStatistics &get_statistics() const { return statistics; }
+
+    //! @brief 統計を消す
+    void reset_statistics() { statistics.reset(); }
 
 private:
-    //! @brief 画像を初期化する
+    //! @brief 1つの数独の盤面ごとの処理データ
+    //!
+    //! 盤面ごとに別のスレッドで処理するため、作業領域も盤面ごとに持つ。
+    struct SudokuGrid
+    {
+        std::vector<cv::Point> contour;              //!< 直線近似した数独の輪郭の頂点データ (入力画像の座標系)
+        cv::Mat gray_frame;                          //!< 歪み補正して結果画像のサイズに合わせた盤面のグレースケール画像
+        cv::Mat binary_frame;                        //!< 歪み補正して二値化した盤面 (枠線を消して文字認識に使う)
+        MeanThreshold mean_threshold;                //!< 盤面を二値化するオブジェクト (積分画像の作業領域を持つ)
+        DigitLocator digit_locator;                  //!< 盤面全体から数字の領域を求めるオブジェクト
+        std::vector<cv::Rect> digit_areas;           //!< 各マスの数字の領域 (マスの座標系)
+        std::vector<DigitCandidate> candidates;      //!< 各マスの認識候補 (マスごとに確度の降順)
+        std::vector<int> candidate_counts;           //!< 各マスの認識候補の数
+        std::vector<char> input_problem;             //!< 数独の初期値 1-9以外は空白や未定
+        std::vector<char> result_problem;            //!< 数独の解答結果 1-9以外は空白や未定
+        SudokuOutcome outcome = OUTCOME_NOT_READY;   //!< この盤面の結果
+        double stage_times[STAGE_NUMBER] = {0};      //!< この盤面の処理の段階ごとの処理時間 (us)
+        cv::Mat overlay_digits;                      //!< 入力画像に重ねる数字 (歪み補正した盤面の座標系)
+        cv::Mat overlay_mask;                        //!< overlay_digits の数字を描いた画素
+        std::vector<char> overlay_problem;           //!< overlay_digits を描いたときの初期値と解 (解が変わったときだけ描き直す)
+        std::unique_ptr<WorkerPool> hypothesis_pool; //!< 認識候補の仮説を並列に解くスレッド
+    };
+
+    //! @brief  input_frame 中の数独を解いて統計を記録する
+    //! @retval true  1つ以上の数独を解けた
+    //! @retval false 数独を解けなかった
+    bool solve();
+
+    //! @brief  画像中の数独を解く (統計を記録しない solve の本体)
+    //! @retval true  1つ以上の数独を解けた
+    //! @retval false 数独を解けなかった
+    bool process_frame();
+
+    //! @brief 入力画像の縮小画像などをグレースケール画像に変換する (入力画像の画素の形式に合わせる)
+    //! @param color_frame 変換する画像
+    //! @param gray_frame  グレースケール画像の書き出し先
+    void convert_gray(const cv::Mat &color_frame, cv::Mat &gray_frame) const;
+
+    //! @brief 画像を初期化する (サイズが同じであれば領域を再利用する)
     //! @param frame 初期化する画像
     //! @param size  初期化後のサイズ
     void frame_initialize(cv::Mat &frame, int size) const;
 
+    //! @brief 入力画像のサイズに合わせて作業用画像の領域を確保する
+    //!
+    //! 作業用画像は入力画像のサイズが変わった場合にだけ確保し直し、それ以外の画像では同じ領域を使い回す。
+    //! @param frame_size 入力画像のサイズ
+    void prepare_buffers(const cv::Size &frame_size);
+
     //! @brief  抽出した輪郭が数独の輪郭として適切であるかの判定
+    //! @param  frame_contour 輪郭
     //! @retval true  適切である
     //! @retval false 適切でない
-    bool is_sudoku_contour();
+    bool is_sudoku_contour(const std::vector<cv::Point> &frame_contour) const;
+
+    //! @brief 結果画像の背景と数字のグリフアトラスを作る (結果画像のサイズを決めたときに1度だけ呼ぶ)
+    void prepare_result_layers();
+
+    //! @brief 盤面ごとの結果を横に並べて結果画像に書き込む (前回書き込んだ結果から変わっていなければ何もしない)
+    void draw_results();
+
+    //! @brief 数独を解いた結果を書き込む (マスごとにグリフアトラスから複写する)
+    //! @param grid 盤面
+    //! @param tile 書き込む画像 (枠線を描いた背景を複写した結果画像の一辺の長さの正方形)
+    void draw_result(const SudokuGrid &grid, cv::Mat &tile) const;
 
-    //! @brief 数独を解いた結果を結果画像に書き込む
-    void draw_result();
+    //! @brief 入力画像に重ねる数字を歪み補正した盤面の座標系で描く (前回描いたときから解が変わった場合だけ描き直す)
+    //! @param grid 盤面 (解けていること)
+    void render_overlay(SudokuGrid &grid) const;
 
-    //! @brief 数独の枠線を結果画像に書き込む
-    void draw_cell();
+    //! @brief 歪み補正した盤面の座標系で描いた数字を、入力画像の数独の領域だけに射影して重ねる
+    //! @param frame         入力画像
+    //! @param frame_contour 数独の輪郭 (入力画像の座標系)
+    //! @param digits        数字を描いた画像
+    //! @param mask          数字を描いた画素
+    void draw_overlay(cv::Mat &frame, const std::vector<cv::Point> &frame_contour, const cv::Mat &digits, const cv::Mat &mask);
 
-    //! @brief  画像の歪み補正
-    //! @retval true  画像から数独を検出できた
+    //! @brief 数独の枠線を書き込む
+    //! @param tile 書き込む画像 (結果画像の一辺の長さの正方形)
+    void draw_cell(cv::Mat &tile) const;
+
+    //! @brief  入力画像が最後に処理した画像から変化していないか調べる
+    //! @retval true  変化していない (処理を省く)
+    //! @retval false 変化した 又は 処理し直す間隔に達した (この画像を処理して次からの比較の基準にする)
+    bool is_static_scene();
+
+    //! @brief  画像中の数独の輪郭を求める
+    //!
+    //! 1つの数独を追跡している場合は追跡し、それ以外は画像全体から抽出する。
+    //! @retval true  画像から1つ以上の数独を検出できた (grids の先頭 grid_count 個に輪郭を書き込む)
     //! @retval false 画像から数独を検出できなかった
-    bool fix_outer_frame();
+    bool find_outer_frames();
+
+    //! @brief  画像全体を二値化して数独の輪郭をすべて抽出する
+    //!
+    //! 解像度の高い入力画像は縮小した段で抽出し、頂点だけを元の解像度で補正する。
+    //! 数独の輪郭として適切な輪郭を面積の大きい順に取り出し、最も大きいものに比べて小さすぎる輪郭は除く。
+    //! @retval true  数独の輪郭を抽出できた
+    //! @retval false 数独の輪郭を抽出できなかった
+    bool detect_outer_contours();
+
+    //! @brief 縮小した段で抽出した輪郭の頂点を、元の解像度の頂点の周りだけで補正する
+    //! @param frame_contour 輪郭 (4頂点 縮小した段の座標系から入力画像の座標系に書き換える)
+    //! @param level         抽出に使った段 (1段ごとに縦横 1/2)
+    void refine_corners(std::vector<cv::Point> &frame_contour, int level);
 
-    //! @brief  画像から数字を認識
+    //! @brief 1つの盤面の歪み補正、枠線の消去、文字認識、数独を解く処理を行う
+    //!
+    //! 盤面ごとに別のスレッドから同時に呼ばれるため、この盤面のデータ以外は書き換えない。
+    //! @param grid 盤面 (輪郭を求めてあること)
+    void process_grid(SudokuGrid &grid) const;
+
+    //! @brief  前の画像の輪郭の頂点を、頂点の周りの小さな探索窓の中で追跡する
+    //!
+    //! 探索窓の中だけでオプティカルフローを求め、逆方向にも追跡して元の位置に戻るかで確かめる。
+    //! 追跡できなかった頂点がある場合や、輪郭の形が大きく変わった場合は追跡を諦める。
+    //! @retval true  追跡できた (contour を更新した)
+    //! @retval false 追跡できなかった (画像全体から抽出し直す)
+    bool track_outer_contour();
+
+    //! @brief 現在の輪郭の頂点の周りの画像を、次の画像で追跡するために保存する
+    //! @param detected 画像全体から抽出した輪郭である場合:true 追跡した輪郭である場合:false
+    void start_tracking(bool detected);
+
+    //! @brief  盤面の画像から数字を認識
+    //! @param  grid 盤面
     //! @retval true  認識したデータが数独である
     //! @retval false 認識したデータが数独でない
-    bool recognize_number();
+    bool recognize_number(SudokuGrid &grid) const;
 
     //! @brief 画像を二値化する
-    //! @param target_frame   処理対象画像
+    //! @param threshold      二値化するオブジェクト
+    //! @param gray_frame     処理対象画像 (グレースケール画像)
+    //! @param binary_frame   二値化した画像の書き出し先 (処理対象画像と同じサイズ 別の領域)
     //! @param threshold_type 反転する場合:THRESH_BINARY_INV しない場合:THRESH_BINARY
-    void make_binary_frame(cv::Mat &target_frame, int threshold_type) const;
+    void make_binary_frame(MeanThreshold &threshold, const cv::Mat &gray_frame, cv::Mat &binary_frame, int threshold_type) const;
 
-    //! @brief  画像から数独の輪郭を抽出して直線近似する
-    //! @retval true  輪郭を抽出できた
-    //! @retval false 輪郭をできなかった
-    bool get_outer_contour();
+    //! @brief  結果画像の座標から入力画像の座標への射影変換を取得する
+    //!
+    //! 結果画像の四隅を数独の輪郭の4頂点に写す変換を閉じた式で求める。
+    //! @param  frame_contour 数独の輪郭 (4頂点)
+    //! @return 射影変換行列 (warpPerspective に WARP_INVERSE_MAP で渡す)
+    cv::Matx33d get_grid_transform(const std::vector<cv::Point> &frame_contour) const;
 
-    //! @brief  ホモグラフィー行列を取得する
-    //! @param  contour    変換元座標平面の４点
-    //! @param  bound_rect 変換先座標平面の４点
-    //! @return 取得したホモグラフィー行列
-    cv::Mat get_homography(const std::vector<cv::Point> &contour, const cv::Rect &bound_rect) const;
+    //! @brief 盤面の画像から枠線を消す
+    //! @param binary_frame 盤面の二値化画像
+    void delete_grid(cv::Mat &binary_frame) const;
 
-    //! @brief 画像から枠線を消す
-    void delete_grid();
+    //! @brief 前回の計測からの経過時間を処理の段階の時間に加える
+    //! @param stage 処理の段階
+    void lap(SudokuStage stage);
 
-    //! @brief  数独を解く
+    //! @brief  盤面の数独を解く
+    //!
+    //! 第1候補の問題が解けない場合は、認識候補から作った尤もらしい別の問題を並列に解く。
+    //! @param  grid 盤面
     //! @retval true  数独を解けた
     //! @retval false 数独を解けなかった
-    bool sudoku_solve();
+    bool sudoku_solve(SudokuGrid &grid) const;
 
     int result_size = 0;  //!< 結果画像の一辺の長さ
     int cell_size = 0;    //!< マスの一辺の長さ
     int text_offset = 0;  //!< 数字表示位置のオフセット
 
-    char *input_problem = nullptr;  //!< 数独の初期値 1-9以外は空白や未定
-    char *result_problem = nullptr; //!< 数独の解答結果 1-9以外は空白や未定
+    std::vector<SudokuGrid> grids;          //!< 盤面ごとの処理データ (見つける数の上限の数だけ最初に確保する)
+    int grid_count = 0;                     //!< 直前の solve で見つけた盤面の数
+    std::unique_ptr<WorkerPool> grid_pool;  //!< 盤面を並列に処理するスレッド
 
     bool initialized = false; //!< オブジェクトが正しく初期化できたかどうか
 
     SudokuOCR *ocr = nullptr; //!< 文字認識部オブジェクト
 
-    cv::VideoCapture capture; //!< ビデオ入力オブジェクト
+    std::string model_path;        //!< 読み込み中のモデルデータのパス (空の場合は既定のモデル)
+    std::future<bool> ocr_loading; //!< バックグラウンドで行うモデルデータの読み込み
+    int ocr_state = 2;             //!< 文字認識の準備状況 (ocr_status の戻り値)
 
     cv::Mat input_frame;  //!< 入力画像
-    cv::Mat temp_frame;   //!< 作業用画像
     cv::Mat result_frame; //!< 結果画像
 
-    std::vector<cv::Point> contour; //!< 直線近似した数独の輪郭の頂点データ
+    int gray_conversion;         //!< 入力画像をグレースケール画像に変換する cvtColor のコード (グレースケール画像の場合は -1)
+    bool gray_borrowed = false;  //!< input_gray_frame が呼び出し元のグレースケール画像を参照しているかどうか
+
+    cv::Mat grid_background;      //!< 枠線だけを描いた盤面 (結果画像の一辺の長さの正方形)
+    cv::Mat glyph_atlas;          //!< 枠線を含むマスに数字を描いた画像を並べたもの (行:初期値の色、解の色 列:1-9)
+    std::vector<char> result_key; //!< 結果画像に書き込む内容の作業領域 (盤面ごとの初期値と解)
+    std::vector<char> drawn_key;  //!< 結果画像に書き込んだ内容 (変わらなければ書き込み直さない)
+
+    bool overlay = false;        //!< 解いた数字を入力画像に重ねるかどうか
+    cv::Mat overlay_roi_digits;  //!< 入力画像の数独の領域に射影した数字の作業領域 (表示段だけが使う)
+    cv::Mat overlay_roi_mask;    //!< 入力画像の数独の領域に射影した数字の画素の作業領域 (表示段だけが使う)
+
+    // 以下の作業用画像は prepare_buffers で1度だけ確保し、画像ごとに使い回す。
+    cv::Size buffer_size;      //!< 作業用画像を確保した入力画像のサイズ
+    cv::Mat input_gray_frame;  //!< 入力画像のグレースケール画像 (画像ごとに1度だけ変換する)
+    cv::Mat scaled_gray_frame; //!< 輪郭を抽出する段に縮小したグレースケール画像
+    cv::Mat detect_frame;      //!< 輪郭を抽出する段の二値化画像
+
+    MeanThreshold mean_threshold; //!< 輪郭を抽出する段を二値化するオブジェクト (積分画像の作業領域を持つ)
+
+    std::vector<std::vector<cv::Point>> contours;   //!< 二値化画像から抽出した輪郭の作業領域
+    std::vector<std::pair<double, int>> contour_candidates; //!< 数独の輪郭の候補の面積と番号の作業領域
+
+    double gate_threshold = DEFAULT_GATE_THRESHOLD; //!< 変化とみなす縮小画像の画素値の差の平均 (0 以下の場合は省かない)
+    int gate_refresh = DEFAULT_GATE_REFRESH;        //!< 変化が無くても処理し直すまでに省く画像の数
+    int gated_frames = 0;                           //!< 最後に処理した後に省いた画像の数
+    bool reused_result = false;                     //!< 直前の solve が前回の結果を使い回したかどうか
+    cv::Mat gate_color;                             //!< 入力画像の縮小画像
+    cv::Mat gate_thumbnail;                         //!< 入力画像の縮小画像のグレースケール画像
+    cv::Mat gate_reference;                         //!< 最後に処理した画像の縮小画像のグレースケール画像
+
+    SudokuOutcome outcome = OUTCOME_NOT_READY;       //!< 直前の solve の結果
+    double stage_times[STAGE_NUMBER] = {0};          //!< 処理の段階ごとの処理時間 (us)
+    std::chrono::steady_clock::time_point stage_mark; //!< lap で前回計測した時刻
+    StageStatistics statistics;                       //!< 段階ごとの処理時間の直近の百分位数と結果の種類ごとの回数の統計
+
+    bool tracking = false;                  //!< 輪郭を追跡しているかどうか
+    int tracked_frames = 0;                 //!< 画像全体から抽出した後に追跡した画像の数
+    double detected_area = 0;               //!< 画像全体から抽出した輪郭の面積
+    std::vector<cv::Point2f> corners;       //!< 追跡している輪郭の頂点 (サブピクセル)
+    std::vector<cv::Rect> corner_windows;   //!< 各頂点の探索窓 (前の画像の座標系)
+    std::vector<cv::Mat> corner_patches;    //!< 前の画像の探索窓のグレースケール画像
+    std::vector<cv::Point2f> flow_from;     //!< オプティカルフローの始点
+    std::vector<cv::Point2f> flow_to;       //!< オプティカルフローの終点
+    std::vector<cv::Point2f> flow_back;     //!< 逆方向のオプティカルフローの終点
+    std::vector<unsigned char> flow_status; //!< オプティカルフローを求められたかどうか
+    std::vector<float> flow_error;          //!< オプティカルフローの誤差
 };
 }
\ No newline at end of file
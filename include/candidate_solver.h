@@ -0,0 +1,40 @@
+//!
+//! @file  candidate_solver.h
+//! @brief candidate_solver モジュール定義 (認識候補を使った複数仮説の数独の求解)
+//!
+
+#pragma once
+
+#include <chrono>
+
+#include "SudokuOCR.h"
+
+namespace videosudoku
+{
+class WorkerPool;
+
+//! @brief 複数仮説の求解の上限
+struct CandidateBudget
+{
+    int max_hypotheses;                  //!< 試す仮説の最大数
+    int max_threads;                     //!< 同時に解くスレッドの最大数 (呼び出したスレッドを含む)
+    std::chrono::microseconds time;      //!< 試す時間の上限
+    WorkerPool *pool;                    //!< 仮説を並列に解くスレッド (nullptr の場合は呼び出したスレッドだけで解く)
+};
+
+//! @brief  認識候補から尤もらしい別の問題を作り、並列に解く
+//!
+//! 第1候補以外の候補への置き換えを、確度の比 (対数尤度の低下) の小さい順に1か所または2か所まで組み合わせて仮説とする。
+//! 仮説は尤もらしい順に並列に解き、解けた仮説のうち最も尤もらしいものを採用する。
+//! マスを空白にする仮説は、解が1つに決まる場合だけ採用する。
+//! budget.pool には、他のスレッドが同時に run しないものを渡す。
+//! @param  candidates     各マスの認識候補 (マスごとに max_candidates 要素 確度の降順)
+//! @param  counts         各マスの認識候補の数
+//! @param  max_candidates 1マスあたりの認識候補の最大数
+//! @param  budget         求解の上限
+//! @param  problem        第1候補の問題 (81文字) 解けた場合は採用した仮説の問題に書き換える
+//! @param  result         数独の解 (82文字 null文字でターミネート)
+//! @retval true           いずれかの仮説を解けた
+//! @retval false          解けなかった
+bool solve_candidates(const DigitCandidate *candidates, const int *counts, int max_candidates, const CandidateBudget &budget, char *problem, char *result);
+}
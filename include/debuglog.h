@@ -2,16 +2,232 @@
 //! @file  debuglog.h
 //! @brief debuglog モジュール定義
 //!
+//! ログは呼び出し元のスレッドでは書式化せず、引数をそのままの形でロックフリーの環状バッファに書き込む。
+//! 書式化と出力 (標準エラー出力) はバックグラウンドのスレッドが行うため、計測している処理の時間をほとんど乱さない。
+//! 出力するレベルは実行時に set_log_level で変えられ、出力しないレベルのログはレベルの比較だけで終わる。
+//!
 
 #pragma once
 
-#include <stdio.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace videosudoku
+{
+//! @brief ログのレベル (値の小さいものほど重要)
+enum LogLevel
+{
+    LOG_LEVEL_NONE = 0, //!< 何も出力しない (set_log_level 用)
+    LOG_LEVEL_ERROR,    //!< エラー
+    LOG_LEVEL_LOG,      //!< 通常のログ
+    LOG_LEVEL_DEBUG     //!< デバッグ
+};
+
+constexpr std::size_t LOG_PAYLOAD_SIZE = 448;     //!< 1つのログの引数を書き込む領域の大きさ (byte)
+constexpr std::size_t LOG_MAX_STRING_LENGTH = 127; //!< 文字列の引数を書き込む最大の長さ (これを超える部分は切り捨てる)
+
+//! @brief  ログの引数を書式化する関数 (引数の型ごとに作られる)
+//! @param  buffer  書き出し先
+//! @param  size    書き出し先の大きさ
+//! @param  format  書式
+//! @param  payload 書き込んだ引数
+//! @return snprintf と同じ
+using LogFormatter = int (*)(char *buffer, std::size_t size, const char *format, const unsigned char *payload);
+
+//! @brief 環状バッファに書き込む1つのログ
+struct LogRecord
+{
+    LogLevel level;                            //!< レベル
+    int line;                                  //!< 呼び出し元の行番号
+    const char *function;                      //!< 呼び出し元の関数名 (静的な文字列)
+    const char *format;                        //!< 書式 (文字列リテラル)
+    LogFormatter formatter;                    //!< 引数を書式化する関数
+    unsigned char payload[LOG_PAYLOAD_SIZE];   //!< 書き込んだ引数
+};
+
+extern std::atomic<int> current_log_level; //!< 出力するレベル (これ以下のレベルを出力する)
+
+//! @brief  指定したレベルのログを出力するかどうか
+//! @param  level レベル
+//! @retval true  出力する
+//! @retval false 出力しない
+inline bool log_enabled(const LogLevel level)
+{
+    return static_cast<int>(level) <= current_log_level.load(std::memory_order_relaxed);
+}
+
+//! @brief 出力するレベルを設定する
+//! @param level レベル (これ以下のレベルを出力する 既定は LOG_LEVEL_DEBUG)
+void set_log_level(LogLevel level);
+
+//! @brief  レベルの名前からレベルを求める
+//! @param  name  名前 (none error log debug のいずれか)
+//! @param  level レベルの書き出し先
+//! @retval true  成功した場合
+//! @retval false 名前が正しくない場合
+bool parse_log_level(const char *name, LogLevel &level);
+
+//! @brief  環状バッファの空きを取得する (複数のスレッドから同時に呼べる)
+//! @param  position 取得した位置の書き出し先 (commit_log_record に渡す)
+//! @retval nullptr 環状バッファが満杯 (ログは捨てられ、捨てた数は後で出力される)
+//! @return others  書き込むログ
+LogRecord *acquire_log_record(std::size_t &position);
+
+//! @brief 書き込んだログをバックグラウンドのスレッドに渡す
+//! @param position acquire_log_record で取得した位置
+void commit_log_record(std::size_t position);
+
+//! @brief 書式を検査するための関数 (呼び出されない分岐に置き、printf と同じ警告をコンパイル時に出す)
+inline void check_log_format(const char *, ...) __attribute__((format(printf, 1, 2)));
+inline void check_log_format(const char *, ...)
+{
+}
+
+//! @brief ログの引数の書き込み方 (数値やポインタはそのまま書き込む)
+template<typename T>
+struct LogArgument
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Log arguments must be trivially copyable.");
+
+    static constexpr std::size_t max_size = sizeof(T); //!< 書き込む最大の大きさ
+
+    //! @brief 引数を書き込む
+    static void encode(unsigned char *&cursor, const T &value)
+    {
+        std::memcpy(cursor, &value, sizeof(T));
+        cursor += sizeof(T);
+    }
+
+    //! @brief 書き込んだ引数を読み出す
+    static void decode(const unsigned char *&cursor, T &value)
+    {
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+    }
+};
+
+//! @brief ログの引数の書き込み方 (文字列はバックグラウンドのスレッドで書式化するまでに書き換えられるため、中身を複製する)
+template<>
+struct LogArgument<const char *>
+{
+    static constexpr std::size_t max_size = LOG_MAX_STRING_LENGTH + 1; //!< 書き込む最大の大きさ
+
+    //! @brief 引数を書き込む
+    static void encode(unsigned char *&cursor, const char *value)
+    {
+        const auto text = value ? value : "(null)";
+        const auto length = strnlen(text, LOG_MAX_STRING_LENGTH);
+
+        std::memcpy(cursor, text, length);
+        cursor[length] = '\0';
+        cursor += length + 1;
+    }
+
+    //! @brief 書き込んだ引数を読み出す (環状バッファの中を指す)
+    static void decode(const unsigned char *&cursor, const char *&value)
+    {
+        value = reinterpret_cast<const char *>(cursor);
+        cursor += std::strlen(value) + 1;
+    }
+};
+
+//! @brief ログの引数を書き込む型 (配列はポインタに、書き換え可能な文字列は const の文字列にそろえる)
+template<typename T>
+using LogArgumentType = typename std::conditional<std::is_same<typename std::decay<T>::type, char *>::value, const char *, typename std::decay<T>::type>::type;
+
+//! @brief  引数を書き込む最大の大きさの合計を求める
+//! @return 大きさ (byte)
+template<typename... Args>
+constexpr std::size_t log_payload_size()
+{
+    std::size_t size = 0;
+    const std::size_t sizes[] = {0, LogArgument<Args>::max_size...};
+
+    for(const auto argument_size: sizes)
+    {
+        size += argument_size;
+    }
+
+    return size;
+}
+
+//! @brief  書き込んだ引数を読み出して書式化する
+//! @param  buffer  書き出し先
+//! @param  size    書き出し先の大きさ
+//! @param  format  書式
+//! @param  payload 書き込んだ引数
+//! @return snprintf と同じ
+template<typename... Args, std::size_t... Indices>
+int format_log_payload(char *buffer, const std::size_t size, const char *format, const unsigned char *payload, std::index_sequence<Indices...>)
+{
+    std::tuple<Args...> values;
+
+    // 書き込んだ順に読み出すため、初期化子リストで評価の順序を決める。
+    const int order[] = {0, (LogArgument<Args>::decode(payload, std::get<Indices>(values)), 0)...};
+
+    static_cast<void>(order);
+    static_cast<void>(payload);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    return std::snprintf(buffer, size, format, std::get<Indices>(values)...);
+#pragma GCC diagnostic pop
+}
+
+//! @brief  書き込んだ引数を読み出して書式化する (LogFormatter として使う)
+template<typename... Args>
+int format_log_record(char *buffer, const std::size_t size, const char *format, const unsigned char *payload)
+{
+    return format_log_payload<Args...>(buffer, size, format, payload, std::index_sequence_for<Args...>());
+}
+
+//! @brief ログを環状バッファに書き込む (マクロから呼ぶ)
+//! @param level    レベル
+//! @param function 呼び出し元の関数名
+//! @param line     呼び出し元の行番号
+//! @param format   書式 (文字列リテラル)
+//! @param args     引数
+template<typename... Args>
+void write_log(const LogLevel level, const char *function, const int line, const char *format, const Args &... args)
+{
+    static_assert(log_payload_size<LogArgumentType<Args>...>() <= LOG_PAYLOAD_SIZE, "Too many log arguments.");
+
+    std::size_t position;
+
+    auto record = acquire_log_record(position);
+
+    if(!record) return;
+
+    record->level = level;
+    record->line = line;
+    record->function = function;
+    record->format = format;
+    record->formatter = &format_log_record<LogArgumentType<Args>...>;
+
+    auto cursor = record->payload;
+    const int order[] = {0, (LogArgument<LogArgumentType<Args>>::encode(cursor, args), 0)...};
+
+    static_cast<void>(order);
+    static_cast<void>(cursor);
+
+    commit_log_record(position);
+}
+}
+
+//! @brief ログを書き込む (書式は文字列リテラルに限る)
+#define DEBUGLOG_WRITE(level, fmt, ...) do { if(::videosudoku::log_enabled(level)) { if(false) ::videosudoku::check_log_format(fmt, ## __VA_ARGS__); ::videosudoku::write_log(level, __FUNCTION__, __LINE__, "" fmt, ## __VA_ARGS__); } } while(0)
 
 //! @brief エラーメッセージを表示する
-#define ERROR(fmt, ...) do { printf("[ERROR] %s(%d) : " fmt "\n", __FUNCTION__, __LINE__, ## __VA_ARGS__); } while(0)
+#define ERROR(fmt, ...) DEBUGLOG_WRITE(::videosudoku::LOG_LEVEL_ERROR, fmt, ## __VA_ARGS__)
 
 //! @brief デバッグメッセージを表示する
-#define DEBUG(fmt, ...) do { printf("[DEBUG] %s(%d) : " fmt "\n", __FUNCTION__, __LINE__, ## __VA_ARGS__); } while(0)
+#define DEBUG(fmt, ...) DEBUGLOG_WRITE(::videosudoku::LOG_LEVEL_DEBUG, fmt, ## __VA_ARGS__)
 
 //! @brief ログを表示する
-#define LOG(fmt, ...) do { printf("[LOG] %s(%d) : " fmt "\n", __FUNCTION__, __LINE__, ## __VA_ARGS__); } while(0)
+#define LOG(fmt, ...) DEBUGLOG_WRITE(::videosudoku::LOG_LEVEL_LOG, fmt, ## __VA_ARGS__)
@@ -0,0 +1,62 @@
+//!
+//! @file  digit_image.h
+//! @brief digit_image モジュール定義 (文字認識の前処理)
+//!
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace videosudoku
+{
+//! @brief  マスの中の領域が数字の領域として適切であるかの判定 (マスの端に接しておらず、十分な大きさがある)
+//! @param  area      マスの中の領域
+//! @param  cell_size マスのサイズ
+//! @retval true      適切である
+//! @retval false     適切でない
+bool is_digit_area(const cv::Rect &area, const cv::Size &cell_size);
+
+//! @brief  マスの画像から輪郭を追跡して数字の領域を探す
+//! @param  src 入力画像 (白地に黒の数字 二値画像)
+//! @return 数字の領域 見つからない場合は空の領域
+cv::Rect find_digit_area(const cv::Mat &src);
+
+//! @brief 数字の領域の高さを一辺とする正方形の領域を切り出す
+//!
+//! 数字の領域が空の場合は周囲の枠を除いた領域を切り出す。
+//! @param src        入力画像
+//! @param digit_area 数字の領域
+//! @param dst        変換画像 (src の部分画像)
+void crop_digit(const cv::Mat &src, const cv::Rect &digit_area, cv::Mat &dst);
+
+//! @brief 正規化 (高さによる正規化)
+//!
+//! find_digit_area で探した領域を crop_digit で切り出す。
+//! @param src 入力画像 (白地に黒の数字 二値画像)
+//! @param dst 変換画像 (src の部分画像)
+void normalize_digit(const cv::Mat &src, cv::Mat &dst);
+
+//! @brief 盤面全体の連結成分から各マスの数字の領域を求めるクラス
+//!
+//! マスごとに輪郭を追跡する代わりに、盤面全体を1度だけラベリングして、連結成分を中心の位置でマスに割り当てる。
+class DigitLocator final
+{
+public:
+    //! @brief 各マスの数字の領域を求める
+    //! @param grid         盤面の画像 (白地に黒の数字 二値画像 枠線は消してあること)
+    //! @param cells_number 一辺のマスの数
+    //! @param cell_size    マスの一辺の長さ
+    //! @param digit_areas  各マスの数字の領域 (マスの座標系 見つからないマスは空の領域)
+    void locate(const cv::Mat &grid, int cells_number, int cell_size, std::vector<cv::Rect> &digit_areas);
+
+private:
+    cv::Mat inverted;  //!< 白黒を反転した盤面
+    cv::Mat labels;    //!< ラベル画像
+    cv::Mat stats;     //!< 連結成分の外接矩形と面積
+    cv::Mat centroids; //!< 連結成分の重心
+
+    std::vector<int> max_areas; //!< 各マスで採用した連結成分の面積
+};
+}
@@ -20,6 +20,15 @@ extern "C"
 //! @retval 1       数独を解けた
 int solve_dlx_sudoku(const char *problem, char *result);
 
+//! @brief  DLXで数独の解の数を数える
+//!
+//! 解が1つに決まるかを調べるため、limit 個の解を見つけた時点で探索を打ち切る。
+//! @param  problem 数独の問題 null文字でターミネートされた文字列で、1-9の数字以外は空白とみなす
+//! @param  result  最初に見つけた数独の解 null文字でターミネートされた文字列で、.は空白を表す
+//! @param  limit   数える解の上限 (1以上)
+//! @return 見つけた解の数 (limit 以下)
+int count_dlx_sudoku(const char *problem, char *result, int limit);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
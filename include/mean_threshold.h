@@ -0,0 +1,42 @@
+//!
+//! @file  mean_threshold.h
+//! @brief mean_threshold モジュール定義
+//!
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace videosudoku
+{
+//! @brief 積分画像を使って局所平均で二値化するクラス
+//!
+//! adaptiveThreshold に ADAPTIVE_THRESH_MEAN_C と BORDER_REPLICATE を指定した場合と同じ結果を返す。
+//! 端を複製した積分画像からブロックの和を4点の参照で求め、丸めた平均との比較を整数の比較1回に置き換えて、
+//! 1行ずつ SSE2 でまとめて二値化する。積分画像の作業領域はインスタンスが保持し、画像のサイズが変わっても使い回す。
+class MeanThreshold final
+{
+public:
+    //! @brief  画像を二値化する
+    //! @param  src            グレースケール画像 (CV_8UC1)
+    //! @param  dst            二値化した画像の書き出し先 (src と同じサイズ 別の領域)
+    //! @param  max_value      条件を満たす画素の値
+    //! @param  threshold_type THRESH_BINARY または THRESH_BINARY_INV
+    //! @param  block_size     平均を求めるブロックの一辺の長さ (3 以上の奇数)
+    //! @param  delta          平均から差し引く定数
+    //! @retval true  成功
+    //! @retval false 画像の型またはブロックの大きさが正しくない
+    bool apply(const cv::Mat &src, cv::Mat &dst, int max_value, int threshold_type, int block_size, double delta);
+
+private:
+    //! @brief 端を複製した画像の積分画像を作る
+    //! @param src    グレースケール画像
+    //! @param radius ブロックの半径
+    void integrate(const cv::Mat &src, int radius);
+
+    std::vector<unsigned int> integral; //!< 端を複製した画像の積分画像 (1行目と1列目は 0 桁あふれしてもブロックの和は正しく求まる)
+    int integral_step = 0;              //!< 積分画像の1行の要素数
+};
+}
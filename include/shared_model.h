@@ -0,0 +1,44 @@
+//!
+//! @file  shared_model.h
+//! @brief 読み込んだモデルをプロセス内で共有する関数定義
+//!
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace videosudoku
+{
+//! @brief  モデルを読み込み、同じファイルを使う呼び出し元の間で共有する
+//!
+//! 読み込んだモデルは参照カウントで管理し、最後の参照が解放された時点で解放する。
+//! 共有するモデルは読み込み後に変更しないため、参照を持つ複数のスレッドから同時に推論してよい。
+//! @param  file_name モデルファイル
+//! @param  load      モデルを読み込む関数 (成功した場合に true を返す モデルの種類ごとに同じ関数を使う)
+//! @retval nullptr   読み込み失敗
+//! @return others    共有するモデル
+template<typename Model>
+std::shared_ptr<const Model> share_model(const char *file_name, bool (*load)(Model &, const char *))
+{
+    static std::mutex lock;
+    static std::map<std::string, std::weak_ptr<const Model>> models;
+
+    // 同じモデルを重複して読み込まないように、読み込みの間も排他する。
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto &shared = models[file_name];
+
+    if(auto model = shared.lock()) return model;
+
+    std::shared_ptr<Model> model(new Model());
+
+    if(!load(*model, file_name)) return nullptr;
+
+    shared = model;
+
+    return model;
+}
+}
@@ -0,0 +1,102 @@
+//!
+//! @file  spsc_queue.h
+//! @brief SPSCQueue クラス定義 (1対1のスレッド間で要素を受け渡す固定長のキュー)
+//!
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace videosudoku
+{
+//! @brief 1つの生産者スレッドと1つの消費者スレッドの間で、事前に確保した要素を受け渡すロックフリーのキュー
+//!
+//! 要素はコピーせず、生産者は acquire で空きの要素を取得して書き込んでから publish し、
+//! 消費者は front で先頭の要素を参照して使い終えてから pop する。要素は使い回すため、画像などの領域は最初に確保したものを再利用できる。
+template<typename T>
+class SPSCQueue final
+{
+public:
+    //! @brief コンストラクタ
+    //! @param capacity 同時に保持できる要素の数
+    explicit SPSCQueue(const std::size_t capacity): slots(capacity + 1)
+    {
+    }
+
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+    //! @brief すべての要素に関数を適用する (領域の事前確保用 スレッドの開始前にのみ呼ぶ)
+    //! @param function 要素を受け取る関数
+    template<typename Function>
+    void for_each_slot(Function function)
+    {
+        for(auto &slot: slots)
+        {
+            function(slot);
+        }
+    }
+
+    //! @brief  生産者: 書き込む要素を取得する
+    //! @retval nullptr キューが満杯
+    //! @return others  書き込む要素 (publish するまで消費者からは見えない)
+    T *acquire()
+    {
+        const auto tail = write_index.load(std::memory_order_relaxed);
+
+        if(next(tail) == read_index.load(std::memory_order_acquire)) return nullptr;
+
+        return &slots[tail];
+    }
+
+    //! @brief 生産者: acquire で取得した要素を消費者に渡す
+    void publish()
+    {
+        write_index.store(next(write_index.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+    //! @brief  消費者: 先頭の要素を参照する
+    //! @retval nullptr キューが空
+    //! @return others  先頭の要素 (pop するまで生産者は書き換えない)
+    T *front()
+    {
+        const auto head = read_index.load(std::memory_order_relaxed);
+
+        if(head == write_index.load(std::memory_order_acquire)) return nullptr;
+
+        return &slots[head];
+    }
+
+    //! @brief  消費者: キューにある要素の数を求める
+    //! @return 要素の数 (生産者が並行して publish した分は含まれないことがある)
+    std::size_t size() const
+    {
+        const auto head = read_index.load(std::memory_order_relaxed);
+        const auto tail = write_index.load(std::memory_order_acquire);
+
+        return tail >= head ? tail - head : tail + slots.size() - head;
+    }
+
+    //! @brief 消費者: 先頭の要素を使い終えて生産者に返す
+    void pop()
+    {
+        read_index.store(next(read_index.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+private:
+    //! @brief  次の位置を求める
+    //! @param  index 位置
+    //! @return 次の位置
+    std::size_t next(const std::size_t index) const
+    {
+        return index + 1 == slots.size() ? 0 : index + 1;
+    }
+
+    std::vector<T> slots; //!< 要素 (1つは満杯と空を区別するために空けておく)
+
+    alignas(64) std::atomic<std::size_t> read_index{0};  //!< 消費者が次に読む位置
+    alignas(64) std::atomic<std::size_t> write_index{0}; //!< 生産者が次に書く位置
+};
+}
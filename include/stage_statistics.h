@@ -0,0 +1,123 @@
+//!
+//! @file  stage_statistics.h
+//! @brief 処理の段階と結果の定義、StageStatistics クラス定義
+//!
+
+#pragma once
+
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace videosudoku
+{
+constexpr auto DEFAULT_STATISTICS_WINDOW = 300; //!< 処理時間の百分位数を求める直近の計測の数の既定値 (30fps で10秒)
+
+//! @brief 1枚の画像の処理の段階 (処理時間を計測する単位)
+enum SudokuStage
+{
+    STAGE_CAPTURE = 0,  //!< ビデオ入力の取得
+    STAGE_BINARIZATION, //!< 輪郭抽出のための二値化
+    STAGE_CONTOUR,      //!< 輪郭の抽出または追跡
+    STAGE_WARP,         //!< 歪み補正と盤面の二値化
+    STAGE_DELETE_GRID,  //!< 枠線の消去
+    STAGE_OCR,          //!< 文字認識
+    STAGE_SOLVE,        //!< 数独を解く
+    STAGE_DISPLAY,      //!< 画面表示
+    STAGE_NUMBER        //!< 段階の数
+};
+
+//! @brief 1枚の画像を処理した結果
+enum SudokuOutcome
+{
+    OUTCOME_NOT_READY = 0, //!< 文字認識の準備ができていない
+    OUTCOME_NO_CONTOUR,    //!< 輪郭が見つからなかった
+    OUTCOME_REJECTED,      //!< 輪郭が数独の形でなかった
+    OUTCOME_FEW_GIVENS,    //!< 認識した数字が17個未満だった
+    OUTCOME_UNSOLVABLE,    //!< 数独を解けなかった
+    OUTCOME_SOLVED,        //!< 数独を解けた
+    OUTCOME_NUMBER         //!< 結果の種類の数
+};
+
+//! @brief  処理の段階の名前を取得する
+//! @param  stage 処理の段階
+//! @return 名前 (英小文字)
+const char *sudokuStageName(SudokuStage stage);
+
+//! @brief  処理した結果の名前を取得する
+//! @param  outcome 処理した結果
+//! @return 名前 (英小文字)
+const char *sudokuOutcomeName(SudokuOutcome outcome);
+
+//! @brief 1つの段階の処理時間の百分位数
+struct StagePercentiles
+{
+    double p50 = 0;   //!< 中央値 (us)
+    double p95 = 0;   //!< 95パーセンタイル (us)
+    double p99 = 0;   //!< 99パーセンタイル (us)
+    long samples = 0; //!< 百分位数を求めた計測の数
+};
+
+//! @brief 段階ごとの処理時間と結果の種類ごとの回数を集計するクラス
+//!
+//! 処理時間は段階ごとに直近の決まった数の計測だけを保持し、百分位数は要求されたときに求める。
+//! 入力、処理、表示の各段のスレッドから同時に記録できる。
+class StageStatistics final
+{
+public:
+    //! @brief コンストラクタ
+    //! @param window 百分位数を求める直近の計測の数
+    explicit StageStatistics(int window = DEFAULT_STATISTICS_WINDOW);
+
+    StageStatistics(const StageStatistics &) = delete;
+    StageStatistics &operator=(const StageStatistics &) = delete;
+
+    //! @brief 処理時間を記録する
+    //! @param stage   処理の段階
+    //! @param time_us 処理時間 (us)
+    void record(SudokuStage stage, double time_us);
+
+    //! @brief 処理した結果を数える
+    //! @param outcome 処理した結果
+    //! @param reused  変化の無い画像として前回の結果を使い回した場合:true
+    void count(SudokuOutcome outcome, bool reused);
+
+    //! @brief  直近の処理時間の百分位数を求める
+    //! @param  stage 処理の段階
+    //! @return 百分位数 (計測が無い場合はすべて 0)
+    StagePercentiles get_percentiles(SudokuStage stage) const;
+
+    //! @brief  処理した結果の回数を取得する (最初または reset からの累計)
+    //! @param  outcome 処理した結果
+    //! @return 回数
+    long get_outcome_count(SudokuOutcome outcome) const;
+
+    //! @brief  前回の結果を使い回した回数を取得する (最初または reset からの累計)
+    //! @return 回数
+    long get_reused_count() const;
+
+    //! @brief 段階ごとの百分位数と結果の種類ごとの回数を書き出す
+    //! @param output 出力先
+    void dump(FILE *output) const;
+
+    //! @brief 集計を消す
+    void reset();
+
+private:
+    //! @brief  直近の処理時間の百分位数を求める (lock を取得してから呼ぶ)
+    //! @param  stage 処理の段階
+    //! @return 百分位数
+    StagePercentiles percentiles(SudokuStage stage) const;
+
+    mutable std::mutex lock; //!< 集計の排他制御
+
+    std::size_t window_size;                   //!< 百分位数を求める直近の計測の数
+    std::vector<double> samples[STAGE_NUMBER]; //!< 段階ごとの直近の処理時間 (環状に上書きする)
+    std::size_t next_sample[STAGE_NUMBER];     //!< 段階ごとの次に上書きする位置
+
+    long outcome_counts[OUTCOME_NUMBER]; //!< 結果の種類ごとの回数
+    long reused_count;                   //!< 前回の結果を使い回した回数
+
+    mutable std::vector<double> sorted_samples; //!< 百分位数を求める作業領域
+};
+}
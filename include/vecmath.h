@@ -0,0 +1,106 @@
+//!
+//! @file  vecmath.h
+//! @brief ベクトル演算モジュール定義
+//!
+
+#pragma once
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace videosudoku
+{
+constexpr auto VECTOR_BLOCK = 16; //!< ベクトル演算の単位 (float の要素数) 配列の長さはこの倍数とする
+
+//! @brief  ベクトル長を VECTOR_BLOCK の倍数に切り上げる
+//! @param  n 要素数
+//! @return 切り上げた要素数
+constexpr int vector_stride(int n)
+{
+    return (n + VECTOR_BLOCK - 1) / VECTOR_BLOCK * VECTOR_BLOCK;
+}
+
+//! @brief  内積を計算する
+//! @param  a ベクトル
+//! @param  b ベクトル
+//! @param  n 要素数 (VECTOR_BLOCK の倍数)
+//! @return 内積
+inline float dot_product(const float *a, const float *b, const int n)
+{
+#ifdef __SSE2__
+    auto sum0 = _mm_setzero_ps();
+    auto sum1 = _mm_setzero_ps();
+    auto sum2 = _mm_setzero_ps();
+    auto sum3 = _mm_setzero_ps();
+
+    for(auto i = 0; i < n; i += VECTOR_BLOCK)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8)));
+        sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12)));
+    }
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, _mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3)));
+
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float sum[4] = {0};
+
+    for(auto i = 0; i < n; i += 4)
+    {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+}
+
+//! @brief  二乗距離を計算する
+//! @param  a ベクトル
+//! @param  b ベクトル
+//! @param  n 要素数 (VECTOR_BLOCK の倍数)
+//! @return 二乗距離
+inline float squared_distance(const float *a, const float *b, const int n)
+{
+#ifdef __SSE2__
+    auto sum0 = _mm_setzero_ps();
+    auto sum1 = _mm_setzero_ps();
+
+    for(auto i = 0; i < n; i += 8)
+    {
+        const auto d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        const auto d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(d0, d0));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(d1, d1));
+    }
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float sum[4] = {0};
+
+    for(auto i = 0; i < n; i += 4)
+    {
+        for(auto j = 0; j < 4; ++j)
+        {
+            const auto d = a[i + j] - b[i + j];
+
+            sum[j] += d * d;
+        }
+    }
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+}
+}
@@ -0,0 +1,59 @@
+//!
+//! @file  worker_pool.h
+//! @brief WorkerPool クラス定義
+//!
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace videosudoku
+{
+//! @brief 決まった数のスレッドを保持し、番号で区別される複数の処理を並列に実行するクラス
+//!
+//! スレッドはコンストラクタで1度だけ作り、run の呼び出しごとには作らない。
+//! run を呼んだスレッドも処理を分担するため、スレッドが 0 個の場合は呼び出し元のスレッドだけで順に実行する。
+class WorkerPool final
+{
+public:
+    //! @brief コンストラクタ
+    //! @param threads 呼び出し元のスレッドとは別に作るスレッドの数
+    explicit WorkerPool(int threads);
+
+    //! @brief デストラクタ (スレッドの終了を待つ)
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    //! @brief 処理を並列に実行し、すべて終わるまで待つ
+    //! @param count 処理の数
+    //! @param work  処理 (0 から count - 1 の番号を受け取る 異なる番号は同時に呼ばれる)
+    void run(int count, const std::function<void(int)> &work);
+
+private:
+    //! @brief 作ったスレッドの処理
+    void worker_loop();
+
+    //! @brief 残っている処理を取り出して実行する
+    void drain();
+
+    std::vector<std::thread> workers; //!< 作ったスレッド
+
+    std::mutex lock;                                //!< 以下の状態の排他制御
+    std::condition_variable wake;                   //!< 新しい処理の開始の通知
+    std::condition_variable finished;               //!< スレッドの処理の終了の通知
+    const std::function<void(int)> *task = nullptr; //!< 実行中の処理
+    int task_count = 0;                             //!< 実行中の処理の数
+    long generation = 0;                            //!< run を呼んだ回数 (スレッドが新しい処理を見分ける)
+    int idle_workers = 0;                           //!< 今回の処理を終えたスレッドの数
+    bool stopping = false;                          //!< スレッドを終了するかどうか
+
+    std::atomic<int> next_task{0}; //!< 次に実行する処理の番号
+};
+}
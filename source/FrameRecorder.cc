@@ -0,0 +1,143 @@
+//!
+//! @file  FrameRecorder.cc
+//! @brief FrameRecorder クラス実装
+//!
+
+#include "FrameRecorder.h"
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+//! @brief 数独の文字列を書き出す
+//! @param output  出力先
+//! @param key     キー
+//! @param problem 数独の文字列 (nullptr の場合は null を書き出す)
+void write_problem(FILE *output, const char *key, const char *problem)
+{
+    if(problem)
+    {
+        fprintf(output, ",\"%s\":\"%s\"", key, problem);
+    }
+    else
+    {
+        fprintf(output, ",\"%s\":null", key);
+    }
+}
+
+//! @brief 1つの数独の輪郭、初期値、解を書き出す
+//!
+//! 各項目はその数独がそれを求める段階まで処理が進んだ場合にだけ書き出し、それ以外は null にする。
+//! @param output       出力先
+//! @param video_sudoku 数独を解いたオブジェクト
+//! @param index        数独の番号
+void write_grid(FILE *output, const VideoSudoku &video_sudoku, const int index)
+{
+    const auto outcome = video_sudoku.get_grid_outcome(index);
+
+    if(outcome >= OUTCOME_FEW_GIVENS)
+    {
+        auto separator = "";
+
+        fputs(",\"corners\":[", output);
+
+        for(const auto &point: video_sudoku.get_contour(index))
+        {
+            fprintf(output, "%s[%d,%d]", separator, point.x, point.y);
+            separator = ",";
+        }
+
+        fputc(']', output);
+    }
+    else
+    {
+        fputs(",\"corners\":null", output);
+    }
+
+    write_problem(output, "grid", outcome >= OUTCOME_UNSOLVABLE ? video_sudoku.get_input_problem(index) : nullptr);
+    write_problem(output, "solution", outcome == OUTCOME_SOLVED ? video_sudoku.get_result_problem(index) : nullptr);
+}
+}
+
+namespace videosudoku
+{
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+bool FrameRecorder::open(const char *file_name)
+{
+    close();
+
+    if(!file_name)
+    {
+        output = stdout;
+
+        return true;
+    }
+
+    output = fopen(file_name, "w");
+    owned = output != nullptr;
+
+    return owned;
+}
+
+void FrameRecorder::close()
+{
+    if(owned)
+    {
+        fclose(output);
+    }
+    else if(output)
+    {
+        fflush(output);
+    }
+
+    output = nullptr;
+    owned = false;
+}
+
+void FrameRecorder::write(const long frame_index, const double timestamp_ms, const VideoSudoku &video_sudoku)
+{
+    if(!output) return;
+
+    const auto outcome = video_sudoku.get_outcome();
+
+    fprintf(output, "{\"frame\":%ld,\"timestamp_ms\":%.3f,\"status\":\"%s\",\"reused\":%s", frame_index, timestamp_ms, sudokuOutcomeName(outcome), video_sudoku.is_result_reused() ? "true" : "false");
+
+    // 先頭の項目は最も面積の大きい数独の結果で、すべての数独の結果は puzzles に書き出す。
+    if(video_sudoku.get_grid_count() > 0)
+    {
+        write_grid(output, video_sudoku, 0);
+    }
+    else
+    {
+        fputs(",\"corners\":null,\"grid\":null,\"solution\":null", output);
+    }
+
+    fputs(",\"puzzles\":[", output);
+
+    for(auto i = 0; i < video_sudoku.get_grid_count(); ++i)
+    {
+        fprintf(output, "%s{\"status\":\"%s\"", i == 0 ? "" : ",", sudokuOutcomeName(video_sudoku.get_grid_outcome(i)));
+        write_grid(output, video_sudoku, i);
+        fputc('}', output);
+    }
+
+    fputc(']', output);
+
+    const auto stage_times = video_sudoku.get_stage_times();
+
+    fputs(",\"timings_us\":{", output);
+
+    for(auto i = 0; i < STAGE_NUMBER; ++i)
+    {
+        fprintf(output, "%s\"%s\":%.1f", i == 0 ? "" : ",", sudokuStageName(static_cast<SudokuStage>(i)), stage_times[i]);
+    }
+
+    fputs("}}\n", output);
+}
+}
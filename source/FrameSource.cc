@@ -0,0 +1,325 @@
+//!
+//! @file  FrameSource.cc
+//! @brief FrameSource クラス実装 ファクトリ実装
+//!
+
+#include "FrameSource.h"
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto default_frame_rate = 30.0; //!< フレームレートが分からない入力を実時間で取得する場合のフレームレート (fps)
+
+//! @brief カメラデバイスまたは動画ファイルから画像を取得するクラス
+class CaptureSource final: public FrameSource
+{
+public:
+    //! @brief コンストラクタ
+    //! @param camera カメラデバイスの場合:true 動画ファイルの場合:false
+    explicit CaptureSource(const bool camera): camera(camera)
+    {
+    }
+
+    bool open(const char *location) override
+    {
+        if(camera)
+        {
+            capture.open(atoi(location));
+        }
+        else
+        {
+            capture.open(location);
+        }
+
+        return capture.isOpened();
+    }
+
+    void close() override
+    {
+        capture.release();
+    }
+
+    Size frame_size() const override
+    {
+        return {static_cast<int>(capture.get(CAP_PROP_FRAME_WIDTH)), static_cast<int>(capture.get(CAP_PROP_FRAME_HEIGHT))};
+    }
+
+    double frame_rate() const override
+    {
+        return capture.get(CAP_PROP_FPS);
+    }
+
+    bool is_live() const override
+    {
+        return camera;
+    }
+
+protected:
+    bool grab(Mat &frame) override
+    {
+        if(!capture.isOpened()) return false;
+
+        capture >> frame;
+
+        return !frame.empty();
+    }
+
+private:
+    const bool camera;    //!< カメラデバイスかどうか
+    VideoCapture capture; //!< ビデオ入力オブジェクト
+};
+
+//! @brief 画像ファイルの連番から画像を取得するクラス
+class ImageSequenceSource final: public FrameSource
+{
+public:
+    bool open(const char *location) override
+    {
+        // パターンが指定されていなければディレクトリ内の全てのファイルを対象にし、読めないファイルは取得時に飛ばす。
+        const string pattern = location;
+
+        files.clear();
+        glob(pattern.find_first_of("*?") == string::npos ? pattern + "/*" : pattern, files, false);
+
+        position = 0;
+        size = {};
+
+        if(files.empty()) return false;
+
+        // 最初に読める画像のサイズを入力のサイズとする。
+        Mat first;
+
+        if(!grab(first)) return false;
+
+        size = first.size();
+        position = 0;
+
+        return true;
+    }
+
+    void close() override
+    {
+        files.clear();
+        position = 0;
+    }
+
+    Size frame_size() const override
+    {
+        return size;
+    }
+
+    double frame_rate() const override
+    {
+        return 0;
+    }
+
+protected:
+    bool grab(Mat &frame) override
+    {
+        while(position < files.size())
+        {
+            frame = imread(files[position++], IMREAD_COLOR);
+
+            if(!frame.empty()) return true;
+        }
+
+        return false;
+    }
+
+private:
+    vector<String> files; //!< 画像ファイルのパス (ファイル名順)
+    size_t position = 0;  //!< 次に読む画像ファイルの位置
+    Size size;            //!< 最初の画像のサイズ
+};
+
+//! @brief 標準入力から生の画像データを取得するクラス
+class StdinSource final: public FrameSource
+{
+public:
+    bool open(const char *location) override
+    {
+        // 書式: <width>x<height>[:bgr|rgb|gray]
+        int width = 0, height = 0;
+        char format[8] = "bgr";
+
+        if(sscanf(location, "%dx%d:%7s", &width, &height, format) < 2 || width <= 0 || height <= 0) return false;
+
+        if(strcmp(format, "bgr") == 0 || strcmp(format, "rgb") == 0)
+        {
+            raw.create(height, width, CV_8UC3);
+        }
+        else if(strcmp(format, "gray") == 0)
+        {
+            raw.create(height, width, CV_8UC1);
+        }
+        else
+        {
+            return false;
+        }
+
+        color_code = strcmp(format, "rgb") == 0 ? COLOR_RGB2BGR : strcmp(format, "gray") == 0 ? COLOR_GRAY2BGR : -1;
+
+        return true;
+    }
+
+    void close() override
+    {
+        raw.release();
+    }
+
+    Size frame_size() const override
+    {
+        return raw.size();
+    }
+
+    double frame_rate() const override
+    {
+        return 0;
+    }
+
+protected:
+    bool grab(Mat &frame) override
+    {
+        if(raw.empty()) return false;
+
+        // BGR の場合は変換が要らないため、取得先の画像に直接読み込む。
+        if(color_code < 0)
+        {
+            frame.create(raw.size(), raw.type());
+
+            return read_raw(frame);
+        }
+
+        if(!read_raw(raw)) return false;
+
+        cvtColor(raw, frame, color_code);
+
+        return true;
+    }
+
+private:
+    //! @brief  標準入力から1枚分の画像データを読み込む
+    //! @param  target 読み込み先の画像 (連続した領域)
+    //! @retval true  成功
+    //! @retval false 失敗 (入力の終わりを含む)
+    static bool read_raw(Mat &target)
+    {
+        const auto bytes = target.total() * target.elemSize();
+
+        return fread(target.data, 1, bytes, stdin) == bytes;
+    }
+
+    Mat raw;             //!< 読み込んだ生の画像データ
+    int color_code = -1; //!< BGR に変換する色変換コード (-1 の場合は変換しない)
+};
+
+//! @brief  文字列が数字だけからなるかどうか調べる
+//! @param  text 文字列
+//! @retval true  数字だけからなる
+//! @retval false それ以外
+bool is_number(const char *text)
+{
+    if(!*text) return false;
+
+    for(; *text; ++text)
+    {
+        if(!isdigit(static_cast<unsigned char>(*text))) return false;
+    }
+
+    return true;
+}
+}
+
+namespace videosudoku
+{
+void FrameSource::set_pacing(const FramePacing frame_pacing, const double frame_rate)
+{
+    pacing = frame_pacing;
+    pacing_rate = frame_rate;
+    started = false;
+}
+
+bool FrameSource::read(Mat &frame)
+{
+    // カメラデバイスが報告するフレームレートは実際と違うことが多く、実際より低いとドライバに画像が溜まって遅延が増えるため待たない。
+    if(pacing == PACING_REALTIME && !is_live())
+    {
+        const auto rate = pacing_rate > 0 ? pacing_rate : frame_rate() > 0 ? frame_rate() : default_frame_rate;
+        const auto interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1 / rate));
+
+        // 取得の時刻を前回の予定時刻から進めるため、処理の揺らぎで再生速度がずれない。遅れた場合は待たずに取得して予定を合わせ直す。
+        const auto now = chrono::steady_clock::now();
+
+        if(!started || next_time < now - interval)
+        {
+            next_time = now;
+            started = true;
+        }
+        else
+        {
+            this_thread::sleep_until(next_time);
+        }
+
+        next_time += interval;
+    }
+
+    return grab(frame);
+}
+
+FrameSource *frameSourceFactory(const char *location)
+{
+    if(!location) return nullptr;
+
+    FrameSource *source = nullptr;
+
+    const auto separator = strchr(location, ':');
+    const auto kind = separator ? string(location, separator) : string();
+    auto argument = separator ? separator + 1 : location;
+
+    if(kind == "camera")
+    {
+        source = new CaptureSource(true);
+    }
+    else if(kind == "video")
+    {
+        source = new CaptureSource(false);
+    }
+    else if(kind == "images")
+    {
+        source = new ImageSequenceSource();
+    }
+    else if(kind == "stdin")
+    {
+        source = new StdinSource();
+    }
+    else
+    {
+        // 種類の指定が無い場合 (または Windows のドライブ名の場合) は、数字ならカメラデバイス、それ以外は動画ファイルとみなす。
+        argument = location;
+        source = new CaptureSource(is_number(location));
+    }
+
+    if(!source->open(argument))
+    {
+        delete source;
+
+        return nullptr;
+    }
+
+    return source;
+}
+}
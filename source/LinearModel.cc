@@ -0,0 +1,310 @@
+//!
+//! @file  LinearModel.cc
+//! @brief LinearModel クラス実装
+//!
+
+#include "LinearModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "vecmath.h"
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr char binary_magic[8] = {'V', 'S', 'L', 'I', 'N', 'B', 'I', 'N'}; //!< 線形モデルの識別子
+
+constexpr auto binary_align = 64u; //!< 各領域のアライメント (バイト)
+
+//! @brief  オフセットを領域のアライメントに切り上げる
+//! @param  offset オフセット
+//! @return 切り上げたオフセット
+uint64_t align_offset(const uint64_t offset)
+{
+    return (offset + binary_align - 1) / binary_align * binary_align;
+}
+
+//! @brief  領域がイメージの範囲内でアライメントされているかの判定
+//! @param  offset 領域のオフセット
+//! @param  bytes  領域のサイズ
+//! @param  size   イメージのサイズ
+//! @retval true   適切である
+//! @retval false  適切でない
+bool is_valid_section(const uint64_t offset, const uint64_t bytes, const uint64_t size)
+{
+    if(offset == 0 || offset % binary_align != 0) return false;
+
+    return offset <= size && bytes <= size - offset;
+}
+
+//! @brief  決定関数の数を求める
+//! @param  type     LinearModelType
+//! @param  nr_class 分類クラス数
+//! @return 決定関数の数
+int function_count(const int type, const int nr_class)
+{
+    return type == LINEAR_ONE_VS_ONE ? nr_class * (nr_class - 1) / 2 : nr_class;
+}
+}
+
+namespace videosudoku
+{
+LinearModel::~LinearModel()
+{
+    release();
+}
+
+bool LinearModel::load(const char *file_name)
+{
+    release();
+
+    if(!file.open(file_name)) return false;
+
+    if(!bind(file.data(), file.size()))
+    {
+        release();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool LinearModel::assign(const LinearModelType type, const int nr_class, const int *labels, const int image_rc, const double *weights, const double *biases)
+{
+    release();
+
+    if(nr_class < 2 || nr_class > LINEAR_MAX_CLASS || image_rc <= 0) return false;
+
+    const auto nr_function = function_count(type, nr_class);
+    const auto dim = image_rc * image_rc;
+    const auto stride = vector_stride(dim);
+
+    linear_binary_header image_header;
+
+    memset(&image_header, 0, sizeof(image_header));
+
+    uint64_t offset = align_offset(sizeof(linear_binary_header));
+
+    image_header.label_offset = offset;
+    offset = align_offset(offset + sizeof(int32_t) * nr_class);
+    image_header.bias_offset = offset;
+    offset = align_offset(offset + sizeof(float) * nr_function);
+    image_header.weight_offset = offset;
+    offset = align_offset(offset + sizeof(float) * stride * nr_function);
+
+    memcpy(image_header.magic, binary_magic, sizeof(binary_magic));
+
+    image_header.version = LINEAR_BINARY_VERSION;
+    image_header.header_size = sizeof(linear_binary_header);
+    image_header.file_size = offset;
+    image_header.type = type;
+    image_header.nr_class = nr_class;
+    image_header.nr_function = nr_function;
+    image_header.image_rc = image_rc;
+    image_header.dim = dim;
+    image_header.stride = stride;
+
+    void *memory = nullptr;
+
+    if(posix_memalign(&memory, binary_align, offset) != 0) return false;
+
+    auto image = static_cast<unsigned char *>(memory);
+
+    memset(image, 0, offset);
+    memcpy(image, &image_header, sizeof(image_header));
+
+    auto image_label = reinterpret_cast<int32_t *>(image + image_header.label_offset);
+    auto image_bias = reinterpret_cast<float *>(image + image_header.bias_offset);
+    auto image_weight = reinterpret_cast<float *>(image + image_header.weight_offset);
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        image_label[i] = labels[i];
+    }
+
+    for(auto f = 0; f < nr_function; ++f)
+    {
+        image_bias[f] = static_cast<float>(biases[f]);
+
+        for(auto i = 0; i < dim; ++i)
+        {
+            image_weight[f * stride + i] = static_cast<float>(weights[f * dim + i]);
+        }
+    }
+
+    buffer = image;
+
+    if(!bind(buffer, offset))
+    {
+        release();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool LinearModel::save(const char *file_name) const
+{
+    if(!header) return false;
+
+    auto fp = fopen(file_name, "wb");
+
+    if(!fp) return false;
+
+    const auto size = static_cast<size_t>(header->file_size);
+    const auto written = fwrite(header, 1, size, fp);
+
+    return (fclose(fp) == 0) && (written == size);
+}
+
+void LinearModel::release()
+{
+    file.close();
+
+    free(buffer);
+
+    buffer = nullptr;
+    header = nullptr;
+    label = nullptr;
+    bias = nullptr;
+    weight = nullptr;
+}
+
+bool LinearModel::bind(const unsigned char *image, const size_t size)
+{
+    if(size < sizeof(linear_binary_header)) return false;
+
+    auto image_header = reinterpret_cast<const linear_binary_header *>(image);
+
+    if(memcmp(image_header->magic, binary_magic, sizeof(binary_magic)) != 0) return false;
+
+    if(image_header->version != LINEAR_BINARY_VERSION) return false;
+    if(image_header->header_size != sizeof(linear_binary_header)) return false;
+    if(image_header->file_size != size) return false;
+
+    if(image_header->type != LINEAR_ONE_VS_ONE && image_header->type != LINEAR_ONE_VS_REST) return false;
+
+    const auto nr_class = image_header->nr_class;
+    const auto nr_function = image_header->nr_function;
+
+    if(nr_class < 2 || nr_class > LINEAR_MAX_CLASS) return false;
+    if(nr_function != function_count(image_header->type, nr_class)) return false;
+    if(image_header->image_rc <= 0 || image_header->dim != image_header->image_rc * image_header->image_rc) return false;
+    if(image_header->stride != vector_stride(image_header->dim)) return false;
+
+    if(!is_valid_section(image_header->label_offset, sizeof(int32_t) * nr_class, size)) return false;
+    if(!is_valid_section(image_header->bias_offset, sizeof(float) * nr_function, size)) return false;
+    if(!is_valid_section(image_header->weight_offset, sizeof(float) * image_header->stride * nr_function, size)) return false;
+
+    header = image_header;
+    label = reinterpret_cast<const int32_t *>(image + image_header->label_offset);
+    bias = reinterpret_cast<const float *>(image + image_header->bias_offset);
+    weight = reinterpret_cast<const float *>(image + image_header->weight_offset);
+
+    return true;
+}
+
+int LinearModel::predict(const float *x, float *scores) const
+{
+    const auto nr_class = header->nr_class;
+    const auto nr_function = header->nr_function;
+    const auto stride = header->stride;
+
+    for(auto f = 0; f < nr_function; ++f)
+    {
+        scores[f] = dot_product(x, weight + f * stride, stride) + bias[f];
+    }
+
+    auto max_index = 0;
+
+    if(header->type == LINEAR_ONE_VS_REST)
+    {
+        for(auto i = 1; i < nr_class; ++i)
+        {
+            if(scores[i] > scores[max_index])
+            {
+                max_index = i;
+            }
+        }
+
+        return label[max_index];
+    }
+
+    int vote[LINEAR_MAX_CLASS] = {0};
+
+    auto p = 0;
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        for(auto j = i + 1; j < nr_class; ++j)
+        {
+            if(scores[p++] > 0)
+            {
+                ++vote[i];
+            }
+            else
+            {
+                ++vote[j];
+            }
+        }
+    }
+
+    for(auto i = 1; i < nr_class; ++i)
+    {
+        if(vote[i] > vote[max_index])
+        {
+            max_index = i;
+        }
+    }
+
+    return label[max_index];
+}
+
+void LinearModel::compute_confidence(const float *scores, double *confidence) const
+{
+    const auto nr_class = header->nr_class;
+
+    if(header->type == LINEAR_ONE_VS_REST)
+    {
+        const auto max_score = *max_element(scores, scores + nr_class);
+
+        auto sum = 0.0;
+
+        for(auto i = 0; i < nr_class; ++i)
+        {
+            confidence[i] = exp(static_cast<double>(scores[i] - max_score));
+            sum += confidence[i];
+        }
+
+        for(auto i = 0; i < nr_class; ++i)
+        {
+            confidence[i] /= sum;
+        }
+
+        return;
+    }
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        confidence[i] = 0;
+    }
+
+    auto p = 0;
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        for(auto j = i + 1; j < nr_class; ++j)
+        {
+            confidence[scores[p++] > 0 ? i : j] += 1.0 / (nr_class - 1);
+        }
+    }
+}
+}
@@ -0,0 +1,145 @@
+//!
+//! @file  LinearOCR.cc
+//! @brief LinearOCR クラス実装
+//!
+
+#include "LinearOCR.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "digit_image.h"
+#include "shared_model.h"
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto DEFAULT_MODEL_FILE = "resource/model/linear15x15.bin";
+
+constexpr auto max_function = LINEAR_MAX_CLASS * (LINEAR_MAX_CLASS - 1) / 2; //!< 決定関数の数の上限
+
+//! @brief  線形モデルを読み込む
+//! @param  model     読み込み先
+//! @param  file_name モデルファイル
+//! @retval true      成功
+//! @retval false     失敗
+bool load_model(LinearModel &model, const char *file_name)
+{
+    return model.load(file_name);
+}
+
+//! @brief  呼び出し元のスレッドの入力データの作業領域を取得する
+//! @param  size 必要な要素数
+//! @return 作業領域 (size 要素 すべて 0)
+float *input_values(const size_t size)
+{
+    thread_local vector<float> x;
+
+    x.assign(size, 0.0f);
+
+    return x.data();
+}
+
+//! @brief  呼び出し元のスレッドの縮小画像の作業領域を取得する
+//! @param  rc 縮小画像の ROW, COL サイズ
+//! @return 作業領域 (rc x rc)
+Mat &small_values(const int rc)
+{
+    thread_local Mat small;
+
+    small.create(rc, rc, CV_8UC1);
+
+    return small;
+}
+}
+
+namespace videosudoku
+{
+bool LinearOCR::initialize(const char *initialize_file_name)
+{
+    // 同じモデルを使う他のインスタンスがあれば、読み込まずにそのモデルを共有する。
+    model = share_model(initialize_file_name ? initialize_file_name : DEFAULT_MODEL_FILE, load_model);
+
+    return static_cast<bool>(model);
+}
+
+void LinearOCR::finalize()
+{
+    model.reset();
+}
+
+int LinearOCR::recognize_number(Mat &mat) const
+{
+    const auto x = input_values(static_cast<size_t>(model->get_stride()));
+
+    float scores[max_function];
+
+    compute_feature(mat, find_digit_area(mat), model->get_image_rc(), x);
+
+    return model->predict(x, scores);
+}
+
+int LinearOCR::recognize_candidates(Mat &mat, DigitCandidate *candidates, const int max_candidates) const
+{
+    return recognize_candidates_at(mat, find_digit_area(mat), candidates, max_candidates);
+}
+
+int LinearOCR::recognize_candidates_at(Mat &mat, const Rect &digit_area, DigitCandidate *candidates, const int max_candidates) const
+{
+    const auto x = input_values(static_cast<size_t>(model->get_stride()));
+
+    float scores[max_function];
+
+    compute_feature(mat, digit_area, model->get_image_rc(), x);
+    model->predict(x, scores);
+
+    const auto nr_class = model->get_nr_class();
+    const auto labels = model->get_labels();
+
+    double confidence[LINEAR_MAX_CLASS];
+
+    model->compute_confidence(scores, confidence);
+
+    DigitCandidate all[LINEAR_MAX_CLASS];
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        all[i] = {labels[i], confidence[i]};
+    }
+
+    const auto count = min(max_candidates, nr_class);
+
+    // 得票数が同じ場合はラベルの順に並ぶように、安定な整列を使う。
+    stable_sort(all, all + nr_class, [](const DigitCandidate &a, const DigitCandidate &b) { return a.confidence > b.confidence; });
+
+    copy(all, all + count, candidates);
+
+    return count;
+}
+
+void LinearOCR::compute_feature(Mat &mat, const Rect &digit_area, const int image_rc, float *x)
+{
+    auto &small = small_values(image_rc);
+
+    crop_digit(mat, digit_area, mat);
+
+    // 面積平均で縮小するため、元の解像度の画素値をブロックごとに平均したものが特徴量になる。
+    resize(mat, small, Size(image_rc, image_rc), 0, 0, INTER_AREA);
+
+    for(auto row = 0; row < image_rc; ++row)
+    {
+        auto ptr = small.ptr<unsigned char>(row);
+
+        for(auto col = 0; col < image_rc; ++col)
+        {
+            x[row * image_rc + col] = *ptr++;
+        }
+    }
+}
+}
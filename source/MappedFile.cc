@@ -0,0 +1,65 @@
+//!
+//! @file  MappedFile.cc
+//! @brief MappedFile クラス実装
+//!
+
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace videosudoku
+{
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char *file_name)
+{
+    close();
+
+    const auto fd = ::open(file_name, O_RDONLY);
+
+    if(fd < 0) return false;
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+
+        return false;
+    }
+
+    const auto file_size = static_cast<std::size_t>(st.st_size);
+
+    // マップはファイルディスクリプタを閉じても有効である。
+    auto mapped = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+
+    if(mapped == MAP_FAILED) return false;
+
+    // 起動直後にすべてのページを参照するため、先読みを要求しておく。
+    madvise(mapped, file_size, MADV_WILLNEED);
+
+    address = static_cast<const unsigned char *>(mapped);
+    length = file_size;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(address)
+    {
+        munmap(const_cast<unsigned char *>(address), length);
+    }
+
+    address = nullptr;
+    length = 0;
+}
+}
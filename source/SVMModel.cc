@@ -0,0 +1,686 @@
+//!
+//! @file  SVMModel.cc
+//! @brief SVMModel クラス実装
+//!
+
+#include "SVMModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "vecmath.h"
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr char binary_magic[8] = {'V', 'S', 'S', 'V', 'M', 'B', 'I', 'N'}; //!< バイナリモデルの識別子
+
+constexpr auto max_pair = SVM_MAX_CLASS * (SVM_MAX_CLASS - 1) / 2; //!< 決定関数の数の上限
+
+constexpr auto min_probability = 1e-7; //!< ペアごとの確率の下限 (libsvm と同じ)
+
+//! @brief  オフセットを領域のアライメントに切り上げる
+//! @param  offset オフセット
+//! @return 切り上げたオフセット
+uint64_t align_offset(const uint64_t offset)
+{
+    return (offset + SVM_BINARY_ALIGN - 1) / SVM_BINARY_ALIGN * SVM_BINARY_ALIGN;
+}
+
+//! @brief  領域がイメージの範囲内でアライメントされているかの判定
+//! @param  offset 領域のオフセット
+//! @param  bytes  領域のサイズ
+//! @param  size   イメージのサイズ
+//! @retval true   適切である
+//! @retval false  適切でない
+bool is_valid_section(const uint64_t offset, const uint64_t bytes, const uint64_t size)
+{
+    if(offset == 0 || offset % SVM_BINARY_ALIGN != 0) return false;
+
+    return offset <= size && bytes <= size - offset;
+}
+
+//! @brief  決定値から確率を推定する (Platt のシグモイド)
+//! @param  decision_value 決定値
+//! @param  a              パラメータA
+//! @param  b              パラメータB
+//! @return 確率
+double sigmoid_predict(const double decision_value, const double a, const double b)
+{
+    const auto fapb = decision_value * a + b;
+
+    // 1 - p の計算で桁落ちしないように符号で式を変える。
+    if(fapb >= 0)
+    {
+        return exp(-fapb) / (1.0 + exp(-fapb));
+    }
+
+    return 1.0 / (1 + exp(fapb));
+}
+
+//! @brief ペアごとの確率から各クラスの確率を推定する (Wu, Lin, Weng の方法 libsvm と同じ反復)
+//! @param k 分類クラス数
+//! @param r ペアごとの確率
+//! @param p 各クラスの確率
+void multiclass_probability(const int k, const double r[][SVM_MAX_CLASS], double *p)
+{
+    double q[SVM_MAX_CLASS][SVM_MAX_CLASS];
+    double qp[SVM_MAX_CLASS];
+
+    const auto max_iteration = max(100, k);
+    const auto eps = 0.005 / k;
+
+    for(auto t = 0; t < k; ++t)
+    {
+        p[t] = 1.0 / k;
+        q[t][t] = 0;
+
+        for(auto j = 0; j < t; ++j)
+        {
+            q[t][t] += r[j][t] * r[j][t];
+            q[t][j] = q[j][t];
+        }
+
+        for(auto j = t + 1; j < k; ++j)
+        {
+            q[t][t] += r[j][t] * r[j][t];
+            q[t][j] = -r[j][t] * r[t][j];
+        }
+    }
+
+    for(auto iteration = 0; iteration < max_iteration; ++iteration)
+    {
+        auto pqp = 0.0;
+
+        for(auto t = 0; t < k; ++t)
+        {
+            qp[t] = 0;
+
+            for(auto j = 0; j < k; ++j)
+            {
+                qp[t] += q[t][j] * p[j];
+            }
+
+            pqp += p[t] * qp[t];
+        }
+
+        auto max_error = 0.0;
+
+        for(auto t = 0; t < k; ++t)
+        {
+            max_error = max(max_error, fabs(qp[t] - pqp));
+        }
+
+        if(max_error < eps) break;
+
+        for(auto t = 0; t < k; ++t)
+        {
+            const auto diff = (-qp[t] + pqp) / q[t][t];
+
+            p[t] += diff;
+            pqp = (pqp + diff * (diff * q[t][t] + 2 * qp[t])) / (1 + diff) / (1 + diff);
+
+            for(auto j = 0; j < k; ++j)
+            {
+                qp[j] = (qp[j] + diff * q[t][j]) / (1 + diff);
+                p[j] /= 1 + diff;
+            }
+        }
+    }
+}
+}
+
+namespace videosudoku
+{
+SVMModel::~SVMModel()
+{
+    release();
+}
+
+bool SVMModel::load(const char *file_name)
+{
+    release();
+
+    if(!file.open(file_name)) return false;
+
+    if(!bind(file.data(), file.size()))
+    {
+        release();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool SVMModel::assign(const svm_model *model, const int dim, const int input_dim, const double *projection_weights, const double *projection_biases)
+{
+    release();
+
+    if(!model || dim <= 0) return false;
+
+    const auto projected = input_dim > 0;
+
+    if(projected && (input_dim < dim || !projection_weights || !projection_biases)) return false;
+
+    const auto input_stride = projected ? vector_stride(input_dim) : 0;
+
+    const auto nr_class = model->nr_class;
+    const auto total_sv = model->l;
+    const auto stride = vector_stride(dim);
+    const auto nr_pair = nr_class * (nr_class - 1) / 2;
+    const auto probability = model->probA && model->probB;
+
+    if(nr_class < 2 || nr_class > SVM_MAX_CLASS || total_sv <= 0) return false;
+
+    // 各領域の配置を決める。
+    svm_binary_header image_header;
+
+    memset(&image_header, 0, sizeof(image_header));
+
+    uint64_t offset = align_offset(sizeof(svm_binary_header));
+
+    image_header.label_offset = offset;
+    offset = align_offset(offset + sizeof(int32_t) * nr_class);
+    image_header.nsv_offset = offset;
+    offset = align_offset(offset + sizeof(int32_t) * nr_class);
+    image_header.rho_offset = offset;
+    offset = align_offset(offset + sizeof(double) * nr_pair);
+
+    if(probability)
+    {
+        image_header.prob_a_offset = offset;
+        offset = align_offset(offset + sizeof(double) * nr_pair);
+        image_header.prob_b_offset = offset;
+        offset = align_offset(offset + sizeof(double) * nr_pair);
+    }
+
+    image_header.sv_coef_offset = offset;
+    offset = align_offset(offset + sizeof(double) * (nr_class - 1) * total_sv);
+    image_header.sv_offset = offset;
+    offset = align_offset(offset + sizeof(float) * stride * total_sv);
+
+    if(projected)
+    {
+        image_header.projection_offset = offset;
+        offset = align_offset(offset + sizeof(float) * input_stride * dim);
+        image_header.projection_bias_offset = offset;
+        offset = align_offset(offset + sizeof(float) * dim);
+    }
+
+    memcpy(image_header.magic, binary_magic, sizeof(binary_magic));
+
+    image_header.version = SVM_BINARY_VERSION;
+    image_header.header_size = sizeof(svm_binary_header);
+    image_header.file_size = offset;
+    image_header.svm_type = model->param.svm_type;
+    image_header.kernel_type = model->param.kernel_type;
+    image_header.degree = model->param.degree;
+    image_header.nr_class = nr_class;
+    image_header.gamma = model->param.gamma;
+    image_header.coef0 = model->param.coef0;
+    image_header.total_sv = total_sv;
+    image_header.dim = dim;
+    image_header.stride = stride;
+    image_header.input_dim = projected ? input_dim : 0;
+
+    void *memory = nullptr;
+
+    if(posix_memalign(&memory, SVM_BINARY_ALIGN, offset) != 0) return false;
+
+    auto image = static_cast<unsigned char *>(memory);
+
+    memset(image, 0, offset);
+    memcpy(image, &image_header, sizeof(image_header));
+
+    auto image_label = reinterpret_cast<int32_t *>(image + image_header.label_offset);
+    auto image_nsv = reinterpret_cast<int32_t *>(image + image_header.nsv_offset);
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        image_label[i] = model->label[i];
+        image_nsv[i] = model->nSV[i];
+    }
+
+    memcpy(image + image_header.rho_offset, model->rho, sizeof(double) * nr_pair);
+
+    if(probability)
+    {
+        memcpy(image + image_header.prob_a_offset, model->probA, sizeof(double) * nr_pair);
+        memcpy(image + image_header.prob_b_offset, model->probB, sizeof(double) * nr_pair);
+    }
+
+    auto image_sv_coef = reinterpret_cast<double *>(image + image_header.sv_coef_offset);
+
+    for(auto i = 0; i < nr_class - 1; ++i)
+    {
+        memcpy(image_sv_coef + i * total_sv, model->sv_coef[i], sizeof(double) * total_sv);
+    }
+
+    // 疎な形式のサポートベクタを密な形式に展開する。
+    auto image_sv = reinterpret_cast<float *>(image + image_header.sv_offset);
+
+    for(auto i = 0; i < total_sv; ++i)
+    {
+        for(auto node = model->SV[i]; node->index != -1; ++node)
+        {
+            if(node->index < 1 || node->index > dim)
+            {
+                free(image);
+
+                return false;
+            }
+
+            image_sv[i * stride + node->index - 1] = static_cast<float>(node->value);
+        }
+    }
+
+    if(projected)
+    {
+        auto image_projection = reinterpret_cast<float *>(image + image_header.projection_offset);
+        auto image_projection_bias = reinterpret_cast<float *>(image + image_header.projection_bias_offset);
+
+        for(auto k = 0; k < dim; ++k)
+        {
+            for(auto i = 0; i < input_dim; ++i)
+            {
+                image_projection[k * input_stride + i] = static_cast<float>(projection_weights[k * input_dim + i]);
+            }
+
+            image_projection_bias[k] = static_cast<float>(projection_biases[k]);
+        }
+    }
+
+    buffer = image;
+    buffer_size = offset;
+
+    if(!bind(buffer, buffer_size))
+    {
+        release();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool SVMModel::save(const char *file_name) const
+{
+    if(!header) return false;
+
+    auto fp = fopen(file_name, "wb");
+
+    if(!fp) return false;
+
+    const auto size = static_cast<size_t>(header->file_size);
+    const auto written = fwrite(header, 1, size, fp);
+
+    return (fclose(fp) == 0) && (written == size);
+}
+
+void SVMModel::release()
+{
+    file.close();
+
+    free(buffer);
+
+    buffer = nullptr;
+    buffer_size = 0;
+
+    header = nullptr;
+    label = nullptr;
+    nsv = nullptr;
+    rho = nullptr;
+    prob_a = nullptr;
+    prob_b = nullptr;
+    sv_coef = nullptr;
+    sv = nullptr;
+    projection = nullptr;
+    projection_bias = nullptr;
+    projection_stride = 0;
+}
+
+bool SVMModel::bind(const unsigned char *image, const size_t size)
+{
+    if(size < sizeof(svm_binary_header)) return false;
+
+    auto image_header = reinterpret_cast<const svm_binary_header *>(image);
+
+    if(memcmp(image_header->magic, binary_magic, sizeof(binary_magic)) != 0) return false;
+
+    if(image_header->version != SVM_BINARY_VERSION) return false;
+    if(image_header->header_size != sizeof(svm_binary_header)) return false;
+    if(image_header->file_size != size) return false;
+
+    if(image_header->svm_type != C_SVC && image_header->svm_type != NU_SVC) return false;
+    if(image_header->kernel_type < LINEAR || image_header->kernel_type > SIGMOID) return false;
+
+    const auto nr_class = image_header->nr_class;
+    const auto total_sv = image_header->total_sv;
+
+    if(nr_class < 2 || nr_class > SVM_MAX_CLASS || total_sv <= 0) return false;
+    if(image_header->dim <= 0 || image_header->stride != vector_stride(image_header->dim)) return false;
+
+    const uint64_t nr_pair = nr_class * (nr_class - 1) / 2;
+
+    if(!is_valid_section(image_header->label_offset, sizeof(int32_t) * nr_class, size)) return false;
+    if(!is_valid_section(image_header->nsv_offset, sizeof(int32_t) * nr_class, size)) return false;
+    if(!is_valid_section(image_header->rho_offset, sizeof(double) * nr_pair, size)) return false;
+    if(!is_valid_section(image_header->sv_coef_offset, sizeof(double) * (nr_class - 1) * total_sv, size)) return false;
+    if(!is_valid_section(image_header->sv_offset, sizeof(float) * image_header->stride * total_sv, size)) return false;
+
+    const auto probability = image_header->prob_a_offset != 0 || image_header->prob_b_offset != 0;
+
+    if(probability)
+    {
+        if(!is_valid_section(image_header->prob_a_offset, sizeof(double) * nr_pair, size)) return false;
+        if(!is_valid_section(image_header->prob_b_offset, sizeof(double) * nr_pair, size)) return false;
+    }
+
+    auto image_nsv = reinterpret_cast<const int32_t *>(image + image_header->nsv_offset);
+    auto sum = 0;
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        if(image_nsv[i] < 0) return false;
+
+        start[i] = sum;
+        sum += image_nsv[i];
+    }
+
+    if(sum != total_sv) return false;
+
+    if(image_header->input_dim < 0) return false;
+
+    const auto projected = image_header->input_dim != 0;
+    const auto input_stride = projected ? vector_stride(image_header->input_dim) : 0;
+
+    if(projected)
+    {
+        if(image_header->input_dim < image_header->dim) return false;
+
+        if(!is_valid_section(image_header->projection_offset, sizeof(float) * input_stride * image_header->dim, size)) return false;
+        if(!is_valid_section(image_header->projection_bias_offset, sizeof(float) * image_header->dim, size)) return false;
+    }
+    else if(image_header->projection_offset != 0 || image_header->projection_bias_offset != 0)
+    {
+        return false;
+    }
+
+    header = image_header;
+    label = reinterpret_cast<const int32_t *>(image + image_header->label_offset);
+    nsv = image_nsv;
+    rho = reinterpret_cast<const double *>(image + image_header->rho_offset);
+    sv_coef = reinterpret_cast<const double *>(image + image_header->sv_coef_offset);
+    sv = reinterpret_cast<const float *>(image + image_header->sv_offset);
+
+    if(probability)
+    {
+        prob_a = reinterpret_cast<const double *>(image + image_header->prob_a_offset);
+        prob_b = reinterpret_cast<const double *>(image + image_header->prob_b_offset);
+    }
+
+    if(projected)
+    {
+        projection = reinterpret_cast<const float *>(image + image_header->projection_offset);
+        projection_bias = reinterpret_cast<const float *>(image + image_header->projection_bias_offset);
+        projection_stride = input_stride;
+    }
+
+    return true;
+}
+
+void SVMModel::project(const float *input, float *x) const
+{
+    const auto dim = header->dim;
+    const auto stride = header->stride;
+
+    for(auto k = 0; k < dim; ++k)
+    {
+        x[k] = dot_product(input, projection + k * projection_stride, projection_stride) + projection_bias[k];
+    }
+
+    for(auto k = dim; k < stride; ++k)
+    {
+        x[k] = 0;
+    }
+}
+
+void SVMModel::compute_kernel(const float *x, double *kvalue) const
+{
+    const auto total_sv = header->total_sv;
+    const auto stride = header->stride;
+    const auto gamma = header->gamma;
+    const auto coef0 = header->coef0;
+
+    switch(header->kernel_type)
+    {
+    case LINEAR:
+        for(auto i = 0; i < total_sv; ++i)
+        {
+            kvalue[i] = dot_product(x, sv + i * stride, stride);
+        }
+        break;
+
+    case POLY:
+        for(auto i = 0; i < total_sv; ++i)
+        {
+            kvalue[i] = pow(gamma * dot_product(x, sv + i * stride, stride) + coef0, header->degree);
+        }
+        break;
+
+    case RBF:
+        for(auto i = 0; i < total_sv; ++i)
+        {
+            kvalue[i] = exp(-gamma * squared_distance(x, sv + i * stride, stride));
+        }
+        break;
+
+    default:
+        for(auto i = 0; i < total_sv; ++i)
+        {
+            kvalue[i] = tanh(gamma * dot_product(x, sv + i * stride, stride) + coef0);
+        }
+        break;
+    }
+}
+
+int SVMModel::predict_values(const float *x, double *kvalue, double *dec_values) const
+{
+    const auto nr_class = header->nr_class;
+    const auto total_sv = header->total_sv;
+
+    compute_kernel(x, kvalue);
+
+    int vote[SVM_MAX_CLASS] = {0};
+
+    // libsvm と同じ順序で one-vs-one の決定関数を評価して投票する。
+    auto p = 0;
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        for(auto j = i + 1; j < nr_class; ++j)
+        {
+            const auto coef1 = sv_coef + (j - 1) * total_sv;
+            const auto coef2 = sv_coef + i * total_sv;
+
+            auto sum = 0.0;
+
+            for(auto k = start[i]; k < start[i] + nsv[i]; ++k)
+            {
+                sum += coef1[k] * kvalue[k];
+            }
+
+            for(auto k = start[j]; k < start[j] + nsv[j]; ++k)
+            {
+                sum += coef2[k] * kvalue[k];
+            }
+
+            sum -= rho[p];
+            dec_values[p] = sum;
+
+            if(sum > 0)
+            {
+                ++vote[i];
+            }
+            else
+            {
+                ++vote[j];
+            }
+
+            ++p;
+        }
+    }
+
+    auto vote_max_index = 0;
+
+    for(auto i = 1; i < nr_class; ++i)
+    {
+        if(vote[i] > vote[vote_max_index])
+        {
+            vote_max_index = i;
+        }
+    }
+
+    return label[vote_max_index];
+}
+
+int SVMModel::predict_probability(const float *x, double *kvalue, double *probability) const
+{
+    double dec_values[max_pair];
+
+    predict_values(x, kvalue, dec_values);
+
+    return probability_from_values(dec_values, probability);
+}
+
+int SVMModel::probability_from_values(const double *dec_values, double *probability) const
+{
+    const auto nr_class = header->nr_class;
+
+    if(!has_probability())
+    {
+        for(auto i = 0; i < nr_class; ++i)
+        {
+            probability[i] = 0;
+        }
+
+        auto k = 0;
+
+        for(auto i = 0; i < nr_class; ++i)
+        {
+            for(auto j = i + 1; j < nr_class; ++j)
+            {
+                probability[dec_values[k++] > 0 ? i : j] += 2.0 / (nr_class * (nr_class - 1));
+            }
+        }
+    }
+    else
+    {
+        double pairwise[SVM_MAX_CLASS][SVM_MAX_CLASS];
+
+        auto k = 0;
+
+        for(auto i = 0; i < nr_class; ++i)
+        {
+            for(auto j = i + 1; j < nr_class; ++j)
+            {
+                const auto pair_probability = sigmoid_predict(dec_values[k], prob_a[k], prob_b[k]);
+
+                pairwise[i][j] = min(max(pair_probability, min_probability), 1 - min_probability);
+                pairwise[j][i] = 1 - pairwise[i][j];
+
+                ++k;
+            }
+        }
+
+        multiclass_probability(nr_class, pairwise, probability);
+    }
+
+    auto probability_max_index = 0;
+
+    for(auto i = 1; i < nr_class; ++i)
+    {
+        if(probability[i] > probability[probability_max_index])
+        {
+            probability_max_index = i;
+        }
+    }
+
+    return label[probability_max_index];
+}
+
+double SVMModel::winner_margin(const double *dec_values, const int winner_index) const
+{
+    auto margin = HUGE_VAL;
+
+    for(auto k = 0; k < header->nr_class; ++k)
+    {
+        if(k == winner_index) continue;
+
+        // 組 (i, j) の決定値は i の勝ちで正になる。
+        const auto value = winner_index < k ? dec_values[pair_index(winner_index, k)] : -dec_values[pair_index(k, winner_index)];
+
+        margin = min(margin, value);
+    }
+
+    return margin;
+}
+
+void SVMModel::approximate_probability(const double *dec_values, const int winner_index, double *probability) const
+{
+    const auto nr_class = header->nr_class;
+
+    auto winner_probability = 1.0;
+    auto sum = 0.0;
+
+    for(auto k = 0; k < nr_class; ++k)
+    {
+        if(k == winner_index) continue;
+
+        const auto p = winner_index < k ? pair_index(winner_index, k) : pair_index(k, winner_index);
+
+        // 組 (i, j) で i が勝つ確率。確率モデルが無い場合は決定値の符号だけを使う。
+        auto i_wins = has_probability() ? sigmoid_predict(dec_values[p], prob_a[p], prob_b[p]) : (dec_values[p] > 0 ? 1.0 : 0.0);
+
+        i_wins = min(max(i_wins, min_probability), 1 - min_probability);
+
+        const auto winner_wins = winner_index < k ? i_wins : 1 - i_wins;
+
+        probability[k] = 1 - winner_wins;
+        winner_probability = min(winner_probability, winner_wins);
+        sum += probability[k];
+    }
+
+    probability[winner_index] = winner_probability;
+    sum += winner_probability;
+
+    for(auto k = 0; k < nr_class; ++k)
+    {
+        probability[k] /= sum;
+    }
+}
+
+int SVMModel::label_index(const int target) const
+{
+    for(auto i = 0; i < header->nr_class; ++i)
+    {
+        if(label[i] == target) return i;
+    }
+
+    return -1;
+}
+
+int SVMModel::pair_index(const int i, const int j) const
+{
+    // 組は (0, 1), (0, 2), ..., (0, n - 1), (1, 2), ... の順に並ぶ。
+    const auto n = header->nr_class;
+
+    return i * (2 * n - i - 1) / 2 + (j - i - 1);
+}
+}
@@ -5,38 +5,92 @@
 
 #include "SVMOCR.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "digit_image.h"
+#include "shared_model.h"
+
 namespace
 {
 using namespace cv;
 using namespace std;
+using namespace videosudoku;
 
-constexpr auto DEFAULT_MODEL_FILE = "resource/model/normalized30x30.model";
-}
+constexpr auto DEFAULT_MODEL_FILE = "resource/model/normalized30x30.bin";
 
-namespace videosudoku
-{
-bool SVMOCR::initialize(const char *initialize_file_name)
+//! @brief  SVMOCR で使えるモデルを読み込む
+//!
+//! バイナリモデルであればマップしてそのまま使い、そうでなければ libsvm のテキスト形式として読み込んで変換する。
+//! @param  model     読み込み先
+//! @param  file_name モデルファイル
+//! @retval true      成功
+//! @retval false     失敗
+bool load_model(SVMModel &model, const char *file_name)
 {
-    if(initialize_file_name)
+    if(!model.load(file_name))
     {
-        model = svm_load_model(initialize_file_name);
+        auto text_model = svm_load_model(file_name);
+
+        if(!text_model) return false;
+
+        const auto result = model.assign(text_model, DATA_SIZE);
+
+        svm_free_and_destroy_model(&text_model);
+
+        if(!result) return false;
     }
-    else
+
+    return model.get_input_dim() == DATA_SIZE && model.get_nr_class() == NR_CLASS;
+}
+
+//! @brief  呼び出し元のスレッドのカーネル値の作業領域を取得する
+//! @param  size 必要な要素数
+//! @return 作業領域
+double *kernel_values(const size_t size)
+{
+    thread_local vector<double> kvalue;
+
+    if(kvalue.size() < size)
     {
-        model = svm_load_model(DEFAULT_MODEL_FILE);
+        kvalue.resize(size);
     }
 
+    return kvalue.data();
+}
+
+//! @brief  呼び出し元のスレッドの縮小した数字画像の作業領域を取得する
+//! @return 作業領域 (IMAGE_RC x IMAGE_RC resize の書き出し先にすると領域を再利用する)
+Mat &digit_values()
+{
+    thread_local Mat digit(IMAGE_RC, IMAGE_RC, CV_8UC1);
+
+    return digit;
+}
+}
+
+namespace videosudoku
+{
+bool SVMOCR::initialize(const char *initialize_file_name)
+{
+    const auto file_name = initialize_file_name ? initialize_file_name : DEFAULT_MODEL_FILE;
+
+    // 同じモデルを使う他のインスタンスがあれば、読み込まずにそのモデルを共有する。
+    model = share_model(file_name, load_model);
+
     if(!model) return false;
 
     // probability にアクセスするため、ラベルに対応する index のテーブルを作成しておく。
+    const auto labels = model->get_labels();
+
     for(auto i = 0; i < NR_CLASS; ++i)
     {
         for(auto j = 0; j < NR_CLASS; ++j)
         {
-            if(model->label[j] == i)
+            if(labels[j] == i)
             {
                 label_to_index[i] = j;
             }
@@ -48,103 +102,107 @@ bool SVMOCR::initialize(const char *initialize_file_name)
 
 void SVMOCR::finalize(void)
 {
-    svm_free_and_destroy_model(&model);
+    model.reset();
 }
 
-int SVMOCR::recognize_number(Mat &mat)
+int SVMOCR::recognize_number(Mat &mat) const
 {
-    compute_feature(mat, data);
+    unsigned char data[DATA_SIZE];
+    double probability[NR_CLASS];
 
-    return predict(data);
+    compute_feature(mat, find_digit_area(mat), data);
+
+    return predict(data, probability);
 }
 
-void SVMOCR::compute_feature(Mat &mat, unsigned char *data) const
+int SVMOCR::recognize_candidates(Mat &mat, DigitCandidate *candidates, const int max_candidates) const
 {
-    normalize(mat, mat);
+    return recognize_candidates_at(mat, find_digit_area(mat), candidates, max_candidates);
+}
 
-    resize(mat, mat, Size(IMAGE_RC, IMAGE_RC));
+int SVMOCR::recognize_candidates_at(Mat &mat, const Rect &digit_area, DigitCandidate *candidates, const int max_candidates) const
+{
+    unsigned char data[DATA_SIZE];
+    double probability[NR_CLASS];
 
-    // 画像データをそのまま１次元の判定データにする。
-    for(auto row = 0; row < mat.rows; ++row)
-    {
-        auto ptr = mat.ptr<unsigned char>(row);
+    compute_feature(mat, digit_area, data);
+    predict(data, probability);
 
-        for(auto col = 0; col < mat.cols; ++col)
-        {
-            data[row * mat.cols + col] = *ptr++;
-        }
+    DigitCandidate all[NR_CLASS];
+
+    for(auto i = 0; i < NR_CLASS; ++i)
+    {
+        all[i] = {i, probability[label_to_index[i]]};
     }
-}
 
-void SVMOCR::normalize(const Mat &src, Mat &dst) const
-{
-    vector<vector<Point>> contours;
-    vector<Vec4i> hierarchy;
-    Rect rect;
+    const auto count = min(max_candidates, NR_CLASS);
 
-    auto area = 0.0;
+    partial_sort(all, all + count, all + NR_CLASS, [](const DigitCandidate &a, const DigitCandidate &b) { return a.confidence > b.confidence; });
 
-    findContours(src.clone(), contours, hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
+    copy(all, all + count, candidates);
 
-    auto max_area = 0.0;
-    auto max_area_index = -1l;
+    return count;
+}
 
-    for(auto i = 0u; i < contours.size(); ++i)
-    {
-        rect = boundingRect(contours[i]);
+void SVMOCR::compute_feature(Mat &mat, const Rect &digit_area, unsigned char *data)
+{
+    auto &digit = digit_values();
 
-        if(rect.x < src.cols * 5 / 100 || rect.y < src.rows * 5 / 100)
-        {
-            continue;
-        }
+    crop_digit(mat, digit_area, mat);
 
-        if(rect.width < src.cols / 10 || rect.height < src.rows * 4 / 10)
-        {
-            continue;
-        }
+    // 切り出した領域のヘッダに縮小すると毎回領域を確保するため、スレッドごとの作業領域に縮小する。
+    resize(mat, digit, Size(IMAGE_RC, IMAGE_RC));
 
-        area = contourArea(contours[i]);
+    // 画像データをそのまま１次元の判定データにする。
+    for(auto row = 0; row < digit.rows; ++row)
+    {
+        auto ptr = digit.ptr<unsigned char>(row);
 
-        if(area > max_area)
+        for(auto col = 0; col < digit.cols; ++col)
         {
-            max_area = area;
-            max_area_index = static_cast<long>(i);
+            data[row * digit.cols + col] = *ptr++;
         }
     }
+}
 
-    if(max_area_index >= 0)
-    {
-        rect = boundingRect(contours[static_cast<unsigned long>(max_area_index)]);
+int SVMOCR::predict(const unsigned char *data, double *probability) const
+{
+    // SVMModel::predict*() を利用するためにデータの変換を行う。
+    // DATA_SIZE 以降の要素は 0 にしておく。
+    alignas(16) float input[DATA_STRIDE] = {0};
 
-        auto x = rect.x + (rect.width / 2) - (rect.height / 2);
+    for(auto i = 0; i < DATA_SIZE; ++i)
+    {
+        input[i] = data[i];
+    }
 
-        if(x < 0)
-        {
-            x = 0;
-        }
+    // 射影を持つモデルは、マスごとに1度だけ低次元に射影してから全サポートベクタとのカーネルを評価する。
+    // 射影後の次元数は DATA_SIZE 以下であることをモデルの読み込み時に確かめてある。
+    alignas(16) float projected[DATA_STRIDE];
 
-        const auto w = x + rect.height > src.cols ? src.cols - x : rect.height;
+    const float *x = input;
 
-        dst = src({x, rect.y, w, rect.height});
-    }
-    else
+    if(model->has_projection())
     {
-        dst = src({src.cols * 5 / 100, src.rows * 5 / 100, src.cols * 9 / 10, src.rows * 9 / 10});
+        model->project(input, projected);
+        x = projected;
     }
-}
 
-int SVMOCR::predict(unsigned char *data)
-{
-    // svm_predict*() を利用するためにデータの変換を行う。
-    for(auto i = 0; i < DATA_SIZE; ++i)
+    double dec_values[NR_PAIR];
+
+    const auto kvalue = kernel_values(static_cast<size_t>(model->get_total_sv()));
+
+    // まず決定値だけを求め、勝者が明らかであれば反復計算による確率の推定を省く。
+    const auto label = model->predict_values(x, kvalue, dec_values);
+    const auto winner_index = model->label_index(label);
+
+    if(probability_margin >= 0 && model->winner_margin(dec_values, winner_index) >= probability_margin)
     {
-        x[i].index = i + 1;
-        x[i].value = data[i];
-    }
+        model->approximate_probability(dec_values, winner_index, probability);
 
-    x[DATA_SIZE].index = -1;
+        return label;
+    }
 
-    // probability が不要であれば、svm_predict() でもよい。
-    return static_cast<int>(svm_predict_probability(model, x, probability));
+    return model->probability_from_values(dec_values, probability);
 }
 }
@@ -0,0 +1,101 @@
+//!
+//! @file  SudokuFrontend.cc
+//! @brief SudokuFrontend クラス実装
+//!
+
+#include "SudokuFrontend.h"
+
+#include <opencv2/highgui.hpp>
+
+#include <chrono>
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto input_name = "Input";   //!< 入力画像ウィンドウの名前
+constexpr auto result_name = "Result"; //!< 結果画像ウィンドウの名前
+
+//! @brief  経過時間を求める
+//! @param  from 開始時刻
+//! @return 経過時間 (us)
+double elapsed_us(const chrono::steady_clock::time_point &from)
+{
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - from).count();
+}
+}
+
+namespace videosudoku
+{
+SudokuFrontend::SudokuFrontend(VideoSudoku &target): video_sudoku(target)
+{
+}
+
+SudokuFrontend::~SudokuFrontend()
+{
+    close();
+}
+
+bool SudokuFrontend::open(const char *location)
+{
+    close();
+
+    source = frameSourceFactory(location);
+
+    return source != nullptr;
+}
+
+void SudokuFrontend::close()
+{
+    if(source)
+    {
+        source->close();
+
+        delete source;
+        source = nullptr;
+    }
+}
+
+void SudokuFrontend::set_pacing(const FramePacing pacing, const double frame_rate)
+{
+    if(source)
+    {
+        source->set_pacing(pacing, frame_rate);
+    }
+}
+
+Size SudokuFrontend::get_frame_size() const
+{
+    return source ? source->frame_size() : Size();
+}
+
+bool SudokuFrontend::capture_video(Mat &frame)
+{
+    if(!source) return false;
+
+    const auto start = chrono::steady_clock::now();
+    const auto captured = source->read(frame);
+
+    video_sudoku.record_stage(STAGE_CAPTURE, elapsed_us(start));
+
+    return captured;
+}
+
+void SudokuFrontend::display(Mat &frame, const vector<vector<Point>> &frame_contours, const Mat *result, const vector<SudokuOverlay> *overlays)
+{
+    const auto start = chrono::steady_clock::now();
+
+    video_sudoku.annotate(frame, frame_contours, overlays);
+
+    imshow(input_name, frame);
+
+    if(result)
+    {
+        imshow(result_name, *result);
+    }
+
+    video_sudoku.record_stage(STAGE_DISPLAY, elapsed_us(start));
+}
+}
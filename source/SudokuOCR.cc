@@ -5,12 +5,95 @@
 
 #include "SudokuOCR.h"
 
+#include <map>
+#include <mutex>
+
+#include "LinearOCR.h"
 #include "SVMOCR.h"
 
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto default_class_name = "SVMOCR"; //!< クラス名が指定されなかった場合に生成するクラス
+
+//! @brief  インスタンスを生成する
+//! @return 生成したインスタンス
+template<typename T>
+SudokuOCR *create()
+{
+    return new T();
+}
+
+//! @brief 登録されているクラスの一覧
+struct Registry
+{
+    mutex lock;                             //!< 一覧の排他制御
+    map<string, SudokuOCRCreator> creators; //!< クラス名と生成関数の対応
+};
+
+//! @brief  組み込みのクラスを登録した一覧を取得する
+//! @return 一覧
+Registry &registry()
+{
+    static Registry instance = {{}, {{"SVMOCR", create<SVMOCR>}, {"LinearOCR", create<LinearOCR>}}};
+
+    return instance;
+}
+}
+
 namespace videosudoku
 {
-SudokuOCR *sudokuOCRFactory(const char *)
+int SudokuOCR::recognize_candidates(cv::Mat &mat, DigitCandidate *candidates, int) const
+{
+    candidates[0] = {recognize_number(mat), 1.0};
+
+    return 1;
+}
+
+int SudokuOCR::recognize_candidates_at(cv::Mat &mat, const cv::Rect &, DigitCandidate *candidates, const int max_candidates) const
+{
+    return recognize_candidates(mat, candidates, max_candidates);
+}
+
+bool registerSudokuOCR(const char *class_name, const SudokuOCRCreator creator)
+{
+    if(!class_name || !creator) return false;
+
+    auto &instance = registry();
+
+    lock_guard<mutex> guard(instance.lock);
+
+    return instance.creators.emplace(class_name, creator).second;
+}
+
+vector<string> sudokuOCRNames()
 {
-    return new SVMOCR();
+    auto &instance = registry();
+
+    lock_guard<mutex> guard(instance.lock);
+
+    vector<string> names;
+
+    for(const auto &entry: instance.creators)
+    {
+        names.push_back(entry.first);
+    }
+
+    return names;
+}
+
+SudokuOCR *sudokuOCRFactory(const char *class_name)
+{
+    auto &instance = registry();
+
+    lock_guard<mutex> guard(instance.lock);
+
+    const auto found = instance.creators.find(class_name ? class_name : default_class_name);
+
+    if(found == instance.creators.end()) return nullptr;
+
+    return found->second();
 }
 }
@@ -0,0 +1,202 @@
+//!
+//! @file  SudokuPipeline.cc
+//! @brief SudokuPipeline クラス実装
+//!
+
+#include "SudokuPipeline.h"
+
+#include <chrono>
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto queue_capacity = 2; //!< 各キューが保持できる画像の数
+
+constexpr auto idle_wait = chrono::milliseconds(1); //!< キューが空の場合に待つ時間
+
+//! @brief  キューに溜まっている古い要素を捨てて、最新の要素を参照する
+//! @param  queue キュー (呼び出し元が消費者)
+//! @retval nullptr キューが空
+//! @return others  最新の要素
+template<typename T>
+T *latest(SPSCQueue<T> &queue)
+{
+    while(queue.size() > 1)
+    {
+        queue.pop();
+    }
+
+    return queue.front();
+}
+}
+
+namespace videosudoku
+{
+SudokuPipeline::SudokuPipeline(VideoSudoku &target, SudokuFrontend &io): video_sudoku(target), frontend(io), process_queue(queue_capacity), display_queue(queue_capacity), result_queue(queue_capacity)
+{
+}
+
+SudokuPipeline::~SudokuPipeline()
+{
+    stop();
+}
+
+void SudokuPipeline::start()
+{
+    stop();
+
+    // 定常状態で画像の領域を確保しないように、キューの要素を最初に確保しておく。
+    const auto frame_size = frontend.get_frame_size();
+    const auto result_size = video_sudoku.get_result_size();
+
+    if(frame_size.area() > 0)
+    {
+        process_queue.for_each_slot([&](Mat &slot) { slot.create(frame_size, CV_8UC3); });
+        display_queue.for_each_slot([&](Mat &slot) { slot.create(frame_size, CV_8UC3); });
+    }
+
+    result_queue.for_each_slot([&](ProcessedFrame &slot)
+    {
+        slot.result.create(result_size, result_size, CV_8UC3);
+        slot.contours.reserve(4);
+    });
+
+    display_contours.reserve(4);
+
+    running = true;
+    capturing = true;
+
+    capture_thread = thread(&SudokuPipeline::capture_loop, this);
+    process_thread = thread(&SudokuPipeline::process_loop, this);
+}
+
+void SudokuPipeline::stop()
+{
+    running = false;
+
+    if(capture_thread.joinable())
+    {
+        capture_thread.join();
+    }
+
+    if(process_thread.joinable())
+    {
+        process_thread.join();
+    }
+}
+
+bool SudokuPipeline::display()
+{
+    auto frame = latest(display_queue);
+
+    if(!frame) return capturing;
+
+    // 結果は入力画像と一緒に表示するため、表示する入力画像がある場合にだけ取り出す。
+    const Mat *result = nullptr;
+
+    auto processed = latest(result_queue);
+
+    if(processed)
+    {
+        // 外側の要素は消さずに残し、輪郭の領域を再利用する。
+        display_contours.resize(processed->contours.size());
+
+        for(auto i = 0u; i < processed->contours.size(); ++i)
+        {
+            display_contours[i].assign(processed->contours[i].begin(), processed->contours[i].end());
+        }
+
+        display_overlays.resize(processed->overlays.size());
+
+        for(auto i = 0u; i < processed->overlays.size(); ++i)
+        {
+            const auto &source_overlay = processed->overlays[i];
+            auto &target_overlay = display_overlays[i];
+
+            target_overlay.contour.assign(source_overlay.contour.begin(), source_overlay.contour.end());
+            source_overlay.digits.copyTo(target_overlay.digits);
+            source_overlay.mask.copyTo(target_overlay.mask);
+        }
+        result = &processed->result;
+    }
+
+    frontend.display(*frame, display_contours, result, &display_overlays);
+
+    display_queue.pop();
+
+    if(processed)
+    {
+        result_queue.pop();
+    }
+
+    return true;
+}
+
+void SudokuPipeline::capture_loop()
+{
+    Mat frame;
+
+    while(running)
+    {
+        // 固定中は入力を読み進めない (動画ファイルや画像の連番が固定の間に進んだり、終わりまで読み切ったりしないように)。
+        if(state_holding)
+        {
+            this_thread::sleep_for(idle_wait);
+
+            continue;
+        }
+
+        if(!frontend.capture_video(frame))
+        {
+            capturing = false;
+
+            return;
+        }
+
+        // 後段が追いついていない場合はその画像を捨て、入力を止めない。
+        if(auto slot = process_queue.acquire())
+        {
+            frame.copyTo(*slot);
+            process_queue.publish();
+        }
+
+        if(auto slot = display_queue.acquire())
+        {
+            frame.copyTo(*slot);
+            display_queue.publish();
+        }
+    }
+}
+
+void SudokuPipeline::process_loop()
+{
+    while(running)
+    {
+        ocr_state = video_sudoku.ocr_status();
+
+        auto frame = process_queue.front();
+
+        if(!frame)
+        {
+            this_thread::sleep_for(idle_wait);
+
+            continue;
+        }
+
+        const auto solved = video_sudoku.solve(*frame);
+
+        // 表示段が追いついていない場合は結果を捨てる。結果画像は次に解けたときに更新される。
+        if(auto processed = result_queue.acquire())
+        {
+            video_sudoku.export_result(solved, processed->result, processed->contours);
+            video_sudoku.export_overlays(processed->overlays);
+            result_queue.publish();
+        }
+
+        process_queue.pop();
+    }
+}
+}
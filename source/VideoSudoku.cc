@@ -9,10 +9,18 @@
 
 #include "VideoSudoku.h"
 
-#include <opencv2/calib3d.hpp>
-#include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
+#include <opencv2/video.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "candidate_solver.h"
 #include "dlx_sudoku.h"
 
 namespace
@@ -29,62 +37,213 @@ constexpr auto pixel_max_value = 255;  //!< ピクセルの値の最大値
 constexpr auto thresh_block_size = 23; //!< 二値化処理のブロックサイズ
 constexpr auto thresh_const = 5.5;     //!< 二値化処理の定数
 
-constexpr auto input_name = "Input";   //!< 入力画像ウィンドウの名前
-constexpr auto result_name = "Result"; //!< 結果画像ウィンドウの名前
+constexpr auto max_candidates = 3;          //!< 1マスあたりの認識候補の最大数
+constexpr auto max_hypotheses = 32;         //!< 第1候補で解けなかった場合に試す仮説の最大数
+constexpr auto hypotheses_time_us = 20000;  //!< 仮説を試す時間の上限 (us)
+constexpr auto max_hypotheses_threads = 4;  //!< 仮説を並列に解くスレッドの最大数
 
-#ifdef VIDEOSUDOKU_DEBUG
-constexpr auto temp_name = "Temp"; //!< 作業用画像ウィンドウの名前
-#endif
+constexpr auto corners_number = 4;         //!< 数独の輪郭の頂点の数
+constexpr auto track_radius = 32;          //!< 頂点を追跡する探索窓の半径 (px)
+constexpr auto track_window = 15;          //!< オプティカルフローの窓の大きさ (px)
+constexpr auto track_levels = 2;           //!< オプティカルフローのピラミッドの段数
+constexpr auto track_max_error = 1.5;      //!< 逆方向に追跡した頂点の元の位置からのずれの許容値 (px)
+constexpr auto track_area_ratio = 1.25;    //!< 画像全体から抽出した輪郭に対する面積の比の許容値
+constexpr auto redetect_interval = 30;     //!< 追跡していても画像全体から抽出し直す間隔 (画像の数)
+constexpr auto detect_max_side = 800;      //!< 輪郭を抽出する画像の長辺の上限 (px これを超える入力画像は縮小する)
+constexpr auto refine_margin = 2;          //!< 頂点の補正の窓に加える余白 (px)
+
+constexpr auto max_grids = 4;              //!< 1つの画像から見つける数独の最大数
+constexpr auto max_contour_candidates = 16; //!< 数独の輪郭として調べる輪郭の最大数 (面積の大きい順)
+constexpr auto min_grid_area_ratio = 0.25;  //!< 最も大きい数独に対する、2つ目以降の数独の面積の比の下限
 
-constexpr auto ocr_type = "SVMOCR"; //!< 文字認識オブジェクトの種類
+constexpr auto gate_thumbnail_width = 64;  //!< 変化を検出する縮小画像の幅 (px)
+constexpr auto gate_thumbnail_height = 48; //!< 変化を検出する縮小画像の高さ (px)
 
-constexpr auto model = "resource/model/normalized30x30.model"; //!< 文字認識に使うモデルデータのパス
+constexpr auto default_ocr_name = "SVMOCR"; //!< 既定の文字認識オブジェクトの種類
 
 const auto contour_line_color = Scalar(0, 255, 0);         //!< 輪郭線色
 const auto frame_background_color = Scalar(255, 255, 255); //!< 画像の背景色
 const auto initial_text_color = Scalar(255, 0, 0);         //!< 数独初期値の文字色
 const auto result_text_color = Scalar(0, 0, 255);          //!< 数独を解いた結果の文字色
 const auto cell_line_color = Scalar(0, 255, 0);            //!< 数独を解いた結果の枠線色
+
+//! @brief  入力画像から輪郭を抽出する段を選ぶ
+//! @param  size 入力画像のサイズ
+//! @return 段 (1段ごとに縦横 1/2)
+int detection_level(const Size &size)
+{
+    auto level = 0;
+
+    while((max(size.width, size.height) >> level) > detect_max_side)
+    {
+        ++level;
+    }
+
+    return level;
+}
+
+//! @brief  単位正方形を四角形に写す射影変換を閉じた式で求める
+//!
+//! 単位正方形の頂点 (0,0) (1,0) (1,1) (0,1) を、四角形の頂点 quad[0] quad[1] quad[2] quad[3] に写す。
+//! 4点の対応だけで決まるため、連立方程式を解かずに直接求める。
+//! @param  quad 四角形の頂点
+//! @return 射影変換行列 (同次座標)
+Matx33d square_to_quad(const Point2d quad[4])
+{
+    const auto sx = quad[0].x - quad[1].x + quad[2].x - quad[3].x;
+    const auto sy = quad[0].y - quad[1].y + quad[2].y - quad[3].y;
+
+    auto g = 0.0;
+    auto h = 0.0;
+
+    // 平行四辺形の場合はアフィン変換になる。
+    if(sx != 0 || sy != 0)
+    {
+        const auto dx1 = quad[1].x - quad[2].x;
+        const auto dx2 = quad[3].x - quad[2].x;
+        const auto dy1 = quad[1].y - quad[2].y;
+        const auto dy2 = quad[3].y - quad[2].y;
+        const auto denominator = dx1 * dy2 - dx2 * dy1;
+
+        if(denominator != 0)
+        {
+            g = (sx * dy2 - dx2 * sy) / denominator;
+            h = (dx1 * sy - sx * dy1) / denominator;
+        }
+    }
+
+    return {quad[1].x - quad[0].x + g * quad[1].x, quad[3].x - quad[0].x + h * quad[3].x, quad[0].x,
+            quad[1].y - quad[0].y + g * quad[1].y, quad[3].y - quad[0].y + h * quad[3].y, quad[0].y,
+            g, h, 1};
+}
+
+//! @brief  画素の形式から画像の型とグレースケール画像への変換を求める
+//!
+//! カメラの BGR 画像は従来から COLOR_RGB2GRAY で変換しているため、同じ場面から同じグレースケール画像が得られるように、
+//! チャンネルの順序が逆の形式は逆の変換を使う。
+//! @param  format     画素の形式
+//! @param  type       画像の型の書き出し先
+//! @param  conversion cvtColor のコードの書き出し先 (グレースケール画像の場合は -1)
+//! @retval true  成功した場合
+//! @retval false 形式が正しくない場合
+bool pixel_layout(const videosudoku::PixelFormat format, int &type, int &conversion)
+{
+    switch(format)
+    {
+    case videosudoku::PIXEL_BGR24:
+        type = CV_8UC3;
+        conversion = COLOR_RGB2GRAY;
+        return true;
+    case videosudoku::PIXEL_RGB24:
+        type = CV_8UC3;
+        conversion = COLOR_BGR2GRAY;
+        return true;
+    case videosudoku::PIXEL_BGRA32:
+        type = CV_8UC4;
+        conversion = COLOR_RGBA2GRAY;
+        return true;
+    case videosudoku::PIXEL_RGBA32:
+        type = CV_8UC4;
+        conversion = COLOR_BGRA2GRAY;
+        return true;
+    case videosudoku::PIXEL_GRAY8:
+        type = CV_8UC1;
+        conversion = -1;
+        return true;
+    default:
+        return false;
+    }
+}
+
+//! @brief  経過時間を求める
+//! @param  from 開始時刻
+//! @param  to   終了時刻
+//! @return 経過時間 (us)
+double elapsed_us(const chrono::steady_clock::time_point &from, const chrono::steady_clock::time_point &to)
+{
+    return chrono::duration<double, micro>(to - from).count();
+}
 }
 
 namespace videosudoku
 {
-VideoSudoku::VideoSudoku()
+VideoSudoku::VideoSudoku(): grids(max_grids)
 {
-    input_problem = new char[all_cells_number + 1];
-    result_problem = new char[all_cells_number + 1];
+    gray_conversion = COLOR_RGB2GRAY;
+
+    for(auto &grid: grids)
+    {
+        grid.contour.reserve(corners_number);
+        grid.candidates.resize(all_cells_number * max_candidates);
+        grid.candidate_counts.resize(all_cells_number);
+        grid.input_problem.assign(all_cells_number + 1, '\0');
+        grid.result_problem.assign(all_cells_number + 1, '\0');
+        grid.overlay_problem.assign(all_cells_number * 2, '\0');
+    }
 }
 
 VideoSudoku::~VideoSudoku()
 {
     finalize();
-
-    delete[] input_problem;
-    delete[] result_problem;
 }
 
-int VideoSudoku::initialize(const int size, const int device_id)
+int VideoSudoku::initialize(const int size, const char *ocr_name, const char *model_file)
 {
     finalize();
 
-    capture.open(device_id);
+    ocr = sudokuOCRFactory(ocr_name ? ocr_name : default_ocr_name);
 
-    if(!capture.isOpened()) return 1;
+    if(!ocr) return 1;
 
-    ocr = sudokuOCRFactory(ocr_type);
+    // モデルデータの読み込みはカメラデバイスを開く処理や最初の画像の表示と並行して行う。
+    model_path = model_file ? model_file : "";
+    ocr_state = 1;
 
-    if(!ocr) return 2;
+    auto loading_ocr = ocr;
+    const auto loading_path = model_file ? model_path.c_str() : nullptr;
 
-    if(!ocr->initialize(model)) return 3;
+    ocr_loading = async(launch::async, [loading_ocr, loading_path]
+    {
+        return loading_ocr->initialize(loading_path);
+    });
 
     result_size = size < result_min_size ? result_min_size : size;
     cell_size = result_size / cells_number;
     text_offset = (cell_size - getTextSize("0", FONT_HERSHEY_SIMPLEX, 1, 3, 0).width) / 2;
 
     frame_initialize(input_frame, result_size);
-    frame_initialize(temp_frame, result_size);
     frame_initialize(result_frame, result_size);
 
+    prepare_result_layers();
+
+    for(auto &grid: grids)
+    {
+        grid.gray_frame.create(result_size, result_size, CV_8UC1);
+        grid.binary_frame.create(result_size, result_size, CV_8UC1);
+        grid.overlay_digits.create(result_size, result_size, CV_8UC3);
+        grid.overlay_mask.create(result_size, result_size, CV_8UC1);
+
+        // 結果画像のサイズが変わった場合に描き直すように、描いた解を消しておく。
+        fill(grid.overlay_problem.begin(), grid.overlay_problem.end(), '\0');
+    }
+
+    // 盤面ごとの処理は呼び出し元のスレッドも加わるため、作るスレッドは1つ少なくする。
+    // 仮説の求解は盤面ごとに同時に行うため、WorkerPool も盤面ごとに持つ。
+    const auto hardware_threads = static_cast<int>(thread::hardware_concurrency());
+
+    if(!grid_pool)
+    {
+        grid_pool.reset(new WorkerPool(max(1, min(hardware_threads, max_grids)) - 1));
+    }
+
+    for(auto &grid: grids)
+    {
+        if(!grid.hypothesis_pool)
+        {
+            grid.hypothesis_pool.reset(new WorkerPool(max(1, min(hardware_threads, max_hypotheses_threads)) - 1));
+        }
+    }
+
     initialized = true;
 
     return 0;
@@ -92,6 +251,15 @@ int VideoSudoku::initialize(const int size, const int device_id)
 
 void VideoSudoku::finalize()
 {
+    // 読み込み中の文字認識オブジェクトを解放しないように、読み込みの完了を待つ。
+    if(ocr_loading.valid())
+    {
+        ocr_loading.wait();
+        ocr_loading = {};
+    }
+
+    ocr_state = 2;
+
     if(ocr)
     {
         ocr->finalize();
@@ -100,90 +268,573 @@ void VideoSudoku::finalize()
         ocr = nullptr;
     }
 
-    capture.release();
-
     initialized = false;
 }
 
-bool VideoSudoku::capture_video()
+void VideoSudoku::set_gating(const double change_threshold, const int refresh_interval)
 {
-    if(!initialized || !capture.isOpened()) return false;
+    gate_threshold = change_threshold;
+    gate_refresh = refresh_interval;
+}
 
-    capture >> input_frame;
+int VideoSudoku::ocr_status()
+{
+    if(ocr_loading.valid() && ocr_loading.wait_for(chrono::seconds(0)) == future_status::ready)
+    {
+        ocr_state = ocr_loading.get() ? 0 : 3;
+    }
 
-    return true;
+    return ocr_state;
+}
+
+int VideoSudoku::wait_ocr()
+{
+    if(ocr_loading.valid())
+    {
+        ocr_loading.wait();
+    }
+
+    return ocr_status();
 }
 
-void VideoSudoku::display(const bool results_availability)
+void VideoSudoku::annotate(Mat &frame, const vector<vector<Point>> &frame_contours, const vector<SudokuOverlay> *overlays)
 {
     if(!initialized) return;
 
-    if(is_sudoku_contour())
+    if(overlays)
     {
-        polylines(input_frame, contour, true, contour_line_color, 2);
+        for(const auto &grid_overlay: *overlays)
+        {
+            draw_overlay(frame, grid_overlay.contour, grid_overlay.digits, grid_overlay.mask);
+        }
     }
 
-    if(results_availability)
+    if(!frame_contours.empty())
     {
-        frame_initialize(result_frame, result_size);
-        draw_result();
-        draw_cell();
+        polylines(frame, frame_contours, true, contour_line_color, 2);
     }
+}
 
-    imshow(input_name, input_frame);
-    imshow(result_name, result_frame);
+void VideoSudoku::record_stage(const SudokuStage stage, const double time_us)
+{
+    if(stage < 0 || stage >= STAGE_NUMBER) return;
 
-#ifdef VIDEOSUDOKU_DEBUG
-    imshow(temp_name, temp_frame);
-#endif
+    stage_times[stage] = time_us;
+    statistics.record(stage, time_us);
+}
+
+void VideoSudoku::export_result(const bool results_availability, Mat &result, vector<vector<Point>> &frame_contours)
+{
+    if(!initialized) return;
+
+    // 前回の結果を使い回した場合は、結果画像も前回描いたままで変わらない。
+    if(results_availability && !reused_result)
+    {
+        draw_results();
+    }
+
+    result_frame.copyTo(result);
+
+    // 外側の要素は消さずに残し、輪郭の領域を次の結果で再利用する。
+    frame_contours.resize(static_cast<size_t>(grid_count));
+
+    for(auto i = 0; i < grid_count; ++i)
+    {
+        const auto &contour = grids[static_cast<size_t>(i)].contour;
+
+        frame_contours[static_cast<size_t>(i)].assign(contour.begin(), contour.end());
+    }
+}
+
+void VideoSudoku::export_overlays(vector<SudokuOverlay> &overlays) const
+{
+    auto count = 0u;
+
+    for(auto i = 0; overlay && i < grid_count; ++i)
+    {
+        if(grids[static_cast<size_t>(i)].outcome == OUTCOME_SOLVED)
+        {
+            ++count;
+        }
+    }
+
+    // 要素の画像の領域は、次に書き出すときにも再利用する。
+    overlays.resize(count);
+
+    auto index = 0u;
+
+    for(auto i = 0; index < count; ++i)
+    {
+        const auto &grid = grids[static_cast<size_t>(i)];
+
+        if(grid.outcome != OUTCOME_SOLVED) continue;
+
+        auto &grid_overlay = overlays[index++];
+
+        grid_overlay.contour.assign(grid.contour.begin(), grid.contour.end());
+        grid.overlay_digits.copyTo(grid_overlay.digits);
+        grid.overlay_mask.copyTo(grid_overlay.mask);
+    }
 }
 
 bool VideoSudoku::solve()
 {
     if(!initialized) return false;
 
-    if(!fix_outer_frame()) return false;
+    const auto solved = process_frame();
+
+    // 実行しなかった段階は百分位数に含めない。
+    for(auto stage = static_cast<int>(STAGE_BINARIZATION); stage < STAGE_DISPLAY; ++stage)
+    {
+        if(stage_times[stage] > 0)
+        {
+            statistics.record(static_cast<SudokuStage>(stage), stage_times[stage]);
+        }
+    }
+
+    statistics.count(outcome, reused_result);
+
+    return solved;
+}
+
+bool VideoSudoku::process_frame()
+{
+    if(input_frame.size() != buffer_size)
+    {
+        prepare_buffers(input_frame.size());
+    }
+
+    // 入力と表示以外の段階の処理時間は、実行しなかった段階が 0 になるように毎回消す。
+    fill(stage_times + STAGE_BINARIZATION, stage_times + STAGE_DISPLAY, 0.0);
 
-    delete_grid();
+    reused_result = false;
 
-    if(recognize_number())
+    // モデルデータの読み込みが終わるまでは入力画像の表示だけを行う。
+    if(ocr_status() != 0)
     {
-        if(sudoku_solve()) return true;
+        outcome = OUTCOME_NOT_READY;
+
+        return false;
     }
 
+    // 前回処理した画像から変化していなければ、前回の輪郭、認識結果、解をそのまま使う。
+    if(is_static_scene())
+    {
+        reused_result = true;
+
+        return outcome == OUTCOME_SOLVED;
+    }
+
+    outcome = OUTCOME_NOT_READY;
+    grid_count = 0;
+    stage_mark = chrono::steady_clock::now();
+
+    // 輪郭が見つからない場合の結果は find_outer_frames の中で決める。
+    if(!find_outer_frames()) return false;
+
+    // 盤面ごとの処理は互いに独立しているため、盤面ごとに別のスレッドで行う。
+    grid_pool->run(grid_count, [this](const int index)
+    {
+        process_grid(grids[static_cast<size_t>(index)]);
+    });
+
+    // 並列に処理した段階の時間は、最も時間のかかった盤面の時間とする。
+    for(auto i = 0; i < grid_count; ++i)
+    {
+        const auto &grid = grids[static_cast<size_t>(i)];
+
+        outcome = max(outcome, grid.outcome);
+
+        for(auto stage = static_cast<int>(STAGE_WARP); stage <= STAGE_SOLVE; ++stage)
+        {
+            stage_times[stage] = max(stage_times[stage], grid.stage_times[stage]);
+        }
+    }
+
+    return outcome == OUTCOME_SOLVED;
+}
+
+bool VideoSudoku::solve(const Mat &frame)
+{
+    // 入力画像は複製せずに参照する。
+    input_frame = frame;
+
+    return solve();
+}
+
+bool VideoSudoku::solve(const unsigned char *pixels, const int width, const int height, const size_t stride, const PixelFormat format, vector<SudokuAnswer> &answers)
+{
+    answers.clear();
+
+    auto type = 0;
+    auto conversion = 0;
+
+    if(!pixels || width <= 0 || height <= 0 || !pixel_layout(format, type, conversion)) return false;
+
+    // 1行に収まらない stride は Mat の生成で例外になるため、ここで弾く (画素は 8bit なのでチャンネル数がバイト数)。
+    if(stride != 0 && stride < static_cast<size_t>(width) * static_cast<size_t>(CV_MAT_CN(type))) return false;
+
+    // 呼び出し元の領域を複製せずに参照する。solve の中では入力画像に書き込まない。
+    input_frame = Mat(height, width, type, const_cast<unsigned char *>(pixels), stride > 0 ? stride : static_cast<size_t>(Mat::AUTO_STEP));
+    gray_conversion = conversion;
+
+    const auto solved = solve();
+
+    export_answers(answers);
+
+    // 呼び出しの後は領域を参照しないように、入力画像を手放して既定の形式に戻す。
+    // グレースケール画像を参照していた場合は、次の画像で変換先の領域に書き込まないように手放す。
+    input_frame.release();
+    gray_conversion = COLOR_RGB2GRAY;
+
+    if(gray_borrowed)
+    {
+        input_gray_frame.release();
+        gray_borrowed = false;
+    }
+
+    return solved;
+}
+
+void VideoSudoku::export_answers(vector<SudokuAnswer> &answers) const
+{
+    answers.resize(static_cast<size_t>(grid_count));
+
+    for(auto i = 0; i < grid_count; ++i)
+    {
+        const auto &grid = grids[static_cast<size_t>(i)];
+        auto &answer = answers[static_cast<size_t>(i)];
+
+        answer.outcome = grid.outcome;
+
+        copy_n(grid.contour.begin(), min(grid.contour.size(), static_cast<size_t>(4)), answer.corners);
+
+        const auto recognized = grid.outcome >= OUTCOME_UNSOLVABLE;
+        const auto solved = grid.outcome == OUTCOME_SOLVED;
+
+        copy(grid.input_problem.begin(), grid.input_problem.end(), answer.grid);
+        copy(grid.result_problem.begin(), grid.result_problem.end(), answer.solution);
+
+        answer.grid[recognized ? all_cells_number : 0] = '\0';
+        answer.solution[solved ? all_cells_number : 0] = '\0';
+    }
+}
+
+bool VideoSudoku::is_static_scene()
+{
+    if(gate_threshold <= 0) return false;
+
+    // 縮小画像は入力画像の全ての画素の平均から作るため、カメラのノイズでは変化とみなしにくい。
+    resize(input_frame, gate_color, gate_color.size(), 0, 0, INTER_AREA);
+    convert_gray(gate_color, gate_thumbnail);
+
+    // 変化はゆっくり動いた場合も取りこぼさないように、直前の画像ではなく最後に処理した画像と比べる。
+    const auto comparable = !gate_reference.empty() && gated_frames < gate_refresh;
+
+    if(comparable && norm(gate_thumbnail, gate_reference, NORM_L1) <= gate_threshold * static_cast<double>(gate_thumbnail.total()))
+    {
+        ++gated_frames;
+
+        return true;
+    }
+
+    // この画像を処理するため、次の画像からはこの画像と比べる。
+    swap(gate_thumbnail, gate_reference);
+    gated_frames = 0;
+
     return false;
 }
 
-bool VideoSudoku::fix_outer_frame()
+bool VideoSudoku::find_outer_frames()
+{
+    // グレースケールへの変換は画像ごとに1度だけ行い、追跡、輪郭の抽出、歪み補正のすべてで使う。
+    if(gray_conversion < 0)
+    {
+        // グレースケール画像が渡された場合は、変換も複製もせずにそのまま参照する。
+        input_gray_frame = input_frame;
+        gray_borrowed = true;
+    }
+    else
+    {
+        cvtColor(input_frame, input_gray_frame, gray_conversion);
+    }
+
+    lap(STAGE_BINARIZATION);
+
+    // 前の画像の輪郭を追跡できれば、画像全体の二値化と輪郭の抽出を省く。
+    const auto tracked = track_outer_contour();
+    lap(STAGE_CONTOUR);
+
+    if(tracked)
+    {
+        grid_count = 1;
+    }
+    else if(!detect_outer_contours())
+    {
+        tracking = false;
+
+        return false;
+    }
+
+    // 追跡は数独が1つだけの場合に行う。複数ある場合は毎回画像全体から抽出する。
+    if(grid_count == 1)
+    {
+        start_tracking(!tracked);
+    }
+    else
+    {
+        tracking = false;
+    }
+
+    return true;
+}
+
+void VideoSudoku::process_grid(SudokuGrid &grid) const
 {
-    input_frame.copyTo(temp_frame);
-    make_binary_frame(temp_frame, THRESH_BINARY_INV);
+    auto mark = chrono::steady_clock::now();
+
+    const auto grid_lap = [&grid, &mark](const SudokuStage stage)
+    {
+        const auto now = chrono::steady_clock::now();
 
-    if(!get_outer_contour()) return false;
+        grid.stage_times[stage] = elapsed_us(mark, now);
+        mark = now;
+    };
 
-    const auto contour_matrix = Mat(contour);
-    const auto epsilon = 0.01 * arcLength(contour_matrix, true);
+    fill(grid.stage_times, grid.stage_times + STAGE_NUMBER, 0.0);
 
-    approxPolyDP(contour_matrix, contour, epsilon, true);
+    // 盤面の画素ごとに入力画像の座標を求めて1度だけ補間する。入力画像全体の変換、切り出し、拡大縮小は行わない。
+    warpPerspective(input_gray_frame, grid.gray_frame, get_grid_transform(grid.contour), grid.gray_frame.size(), INTER_LINEAR | WARP_INVERSE_MAP);
 
-    if(!is_sudoku_contour()) return false;
+    make_binary_frame(grid.mean_threshold, grid.gray_frame, grid.binary_frame, THRESH_BINARY);
+    grid_lap(STAGE_WARP);
 
-    input_frame.copyTo(temp_frame);
+    delete_grid(grid.binary_frame);
+    grid_lap(STAGE_DELETE_GRID);
 
-    const auto bound_rect = boundingRect(contour);
-    const auto homography = get_homography(contour, bound_rect);
+    const auto recognized = recognize_number(grid);
+    grid_lap(STAGE_OCR);
 
-    warpPerspective(temp_frame, temp_frame, homography, temp_frame.size());
+    if(!recognized)
+    {
+        grid.outcome = OUTCOME_FEW_GIVENS;
+
+        return;
+    }
+
+    const auto solved = sudoku_solve(grid);
+    grid_lap(STAGE_SOLVE);
 
-    temp_frame = {temp_frame, bound_rect};
-    resize(temp_frame, temp_frame, {result_size, result_size});
+    grid.outcome = solved ? OUTCOME_SOLVED : OUTCOME_UNSOLVABLE;
+
+    if(overlay && solved)
+    {
+        render_overlay(grid);
+    }
+}
+
+bool VideoSudoku::detect_outer_contours()
+{
+    // 長辺が上限以下になる段を選ぶ。二値化と輪郭の抽出の時間は入力画像の解像度によらずほぼ一定になる。
+    const auto level = detection_level(input_frame.size());
+
+    // 縮小しない場合は入力画像のグレースケール画像を複製せずにそのまま二値化する。
+    if(level > 0)
+    {
+        resize(input_gray_frame, scaled_gray_frame, scaled_gray_frame.size(), 0, 0, INTER_AREA);
+    }
 
-    make_binary_frame(temp_frame, THRESH_BINARY);
+    make_binary_frame(mean_threshold, level > 0 ? scaled_gray_frame : input_gray_frame, detect_frame, THRESH_BINARY_INV);
+
+    lap(STAGE_BINARIZATION);
+
+    // 二値化画像は輪郭の抽出で書き換えられるが、この後は使わないため複製しない。
+    findContours(detect_frame, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
+
+    if(contours.empty())
+    {
+        lap(STAGE_CONTOUR);
+        outcome = OUTCOME_NO_CONTOUR;
+
+        return false;
+    }
+
+    // 数字や文字の輪郭も数多く見つかるため、面積の大きい輪郭だけを数独の候補として調べる。
+    contour_candidates.clear();
+
+    for(auto i = 0u; i < contours.size(); ++i)
+    {
+        contour_candidates.emplace_back(contourArea(contours[i]), static_cast<int>(i));
+    }
+
+    const auto candidates_end = contour_candidates.begin() + static_cast<ptrdiff_t>(min(contour_candidates.size(), static_cast<size_t>(max_contour_candidates)));
+
+    partial_sort(contour_candidates.begin(), candidates_end, contour_candidates.end(), greater<pair<double, int>>());
+
+    auto min_area = 0.0;
+
+    for(auto candidate = contour_candidates.begin(); candidate != candidates_end && grid_count < max_grids; ++candidate)
+    {
+        // 最も大きい数独に比べて小さすぎる輪郭は、数独の中のマスや紙面の図などとみなして調べない。
+        if(candidate->first < min_area) break;
+
+        const auto &frame_contour = contours[static_cast<size_t>(candidate->second)];
+        auto &grid = grids[static_cast<size_t>(grid_count)];
+
+        approxPolyDP(frame_contour, grid.contour, 0.01 * arcLength(frame_contour, true), true);
+
+        if(grid.contour.size() != corners_number) continue;
+
+        if(level > 0)
+        {
+            refine_corners(grid.contour, level);
+        }
+
+        if(!is_sudoku_contour(grid.contour)) continue;
+
+        // 外側の輪郭だけを抽出しているため、見つけた数独どうしが重なることはない。
+        if(grid_count == 0)
+        {
+            min_area = candidate->first * min_grid_area_ratio;
+        }
+
+        ++grid_count;
+    }
+
+    lap(STAGE_CONTOUR);
+
+    if(grid_count == 0)
+    {
+        outcome = OUTCOME_REJECTED;
+
+        return false;
+    }
 
     return true;
 }
 
-bool VideoSudoku::recognize_number()
+void VideoSudoku::refine_corners(vector<Point> &frame_contour, const int level)
+{
+    const auto scale = 1 << level;
+    const auto window_size = scale + refine_margin;
+    const auto radius = window_size + refine_margin;
+    const Rect frame_rect = {0, 0, input_frame.cols, input_frame.rows};
+
+    for(auto &point: frame_contour)
+    {
+        // 縮小した段の画素の中心を元の解像度の座標に戻す。
+        const auto x = (point.x * 2 + 1) * scale / 2;
+        const auto y = (point.y * 2 + 1) * scale / 2;
+
+        point = {x, y};
+
+        const Rect window = {x - radius, y - radius, 2 * radius + 1, 2 * radius + 1};
+
+        // 画像の端に近い頂点は補正せずに戻した座標を使う。
+        if((window & frame_rect) != window) continue;
+
+        flow_from.assign(1, Point2f(static_cast<float>(radius), static_cast<float>(radius)));
+
+        cornerSubPix(Mat(input_gray_frame, window), flow_from, {window_size, window_size}, {-1, -1}, {TermCriteria::COUNT + TermCriteria::EPS, 20, 0.03});
+
+        point = {window.x + cvRound(flow_from[0].x), window.y + cvRound(flow_from[0].y)};
+    }
+}
+
+bool VideoSudoku::track_outer_contour()
+{
+    if(!tracking || tracked_frames >= redetect_interval) return false;
+
+    const Rect frame_rect = {0, 0, input_frame.cols, input_frame.rows};
+
+    for(auto i = 0; i < corners_number; ++i)
+    {
+        const auto &window = corner_windows[static_cast<size_t>(i)];
+        const auto &previous_patch = corner_patches[static_cast<size_t>(i)];
+        const auto origin = Point2f(static_cast<float>(window.x), static_cast<float>(window.y));
+
+        if((window & frame_rect) != window) return false;
+
+        // 前の画像と同じ位置の探索窓だけを比べる。
+        const Mat corner_patch = {input_gray_frame, window};
+
+        flow_from.assign(1, corners[static_cast<size_t>(i)] - origin);
+
+        calcOpticalFlowPyrLK(previous_patch, corner_patch, flow_from, flow_to, flow_status, flow_error, {track_window, track_window}, track_levels);
+
+        if(!flow_status[0]) return false;
+
+        // 逆方向にも追跡し、元の位置に戻らなければ追跡の信頼度が低いとみなす。
+        calcOpticalFlowPyrLK(corner_patch, previous_patch, flow_to, flow_back, flow_status, flow_error, {track_window, track_window}, track_levels);
+
+        if(!flow_status[0] || norm(flow_back[0] - flow_from[0]) > track_max_error) return false;
+
+        corners[static_cast<size_t>(i)] = flow_to[0] + origin;
+    }
+
+    // 追跡は数独が1つだけの場合に行うため、先頭の盤面の輪郭を更新する。
+    auto &contour = grids[0].contour;
+
+    for(auto i = 0; i < corners_number; ++i)
+    {
+        contour[static_cast<size_t>(i)] = {cvRound(corners[static_cast<size_t>(i)].x), cvRound(corners[static_cast<size_t>(i)].y)};
+    }
+
+    if(!is_sudoku_contour(contour)) return false;
+
+    const auto area = contourArea(contour);
+
+    if(area > detected_area * track_area_ratio || area * track_area_ratio < detected_area) return false;
+
+    ++tracked_frames;
+
+    return true;
+}
+
+void VideoSudoku::start_tracking(const bool detected)
+{
+    const Rect frame_rect = {0, 0, input_frame.cols, input_frame.rows};
+    const auto &contour = grids[0].contour;
+
+    if(detected)
+    {
+        corners.resize(corners_number);
+
+        for(auto i = 0; i < corners_number; ++i)
+        {
+            corners[static_cast<size_t>(i)] = Point2f(static_cast<float>(contour[static_cast<size_t>(i)].x), static_cast<float>(contour[static_cast<size_t>(i)].y));
+        }
+
+        tracked_frames = 0;
+        detected_area = contourArea(contour);
+    }
+
+    corner_windows.resize(corners_number);
+    corner_patches.resize(corners_number);
+
+    tracking = true;
+
+    for(auto i = 0; i < corners_number; ++i)
+    {
+        const auto &corner = corners[static_cast<size_t>(i)];
+
+        const Rect window = {cvRound(corner.x) - track_radius, cvRound(corner.y) - track_radius, 2 * track_radius + 1, 2 * track_radius + 1};
+
+        // 探索窓が画像からはみ出す場合は追跡しない。
+        if((window & frame_rect) != window)
+        {
+            tracking = false;
+
+            return;
+        }
+
+        corner_windows[static_cast<size_t>(i)] = window;
+
+        Mat(input_gray_frame, window).copyTo(corner_patches[static_cast<size_t>(i)]);
+    }
+}
+
+bool VideoSudoku::recognize_number(SudokuGrid &grid) const
 {
     // 数独の初期値として適切かどうか調べるために、文字を認識する前にすべてのマスに数字が詰まっているとみなす。
     // 数字の詰まっているマスの数を保持しておき、数字の無いマスを見つけ次第差し引いていく。
@@ -193,6 +844,9 @@ bool VideoSudoku::recognize_number()
 
     Point position;
 
+    // マスごとに輪郭を追跡する代わりに、盤面全体を1度だけラベリングして数字の領域を求めておく。
+    grid.digit_locator.locate(grid.binary_frame, cells_number, cell_size, grid.digit_areas);
+
     for(auto i = 0; i < all_cells_number; ++i)
     {
         position.x = (i % cells_number) * cell_size;
@@ -200,9 +854,13 @@ bool VideoSudoku::recognize_number()
 
         const Rect cut_area = {position.x, position.y, cell_size, cell_size};
 
-        Mat cut_frame = {temp_frame, cut_area};
+        Mat cut_frame = {grid.binary_frame, cut_area};
 
-        number = ocr->recognize_number(cut_frame);
+        const auto cell_candidates = &grid.candidates[static_cast<size_t>(i * max_candidates)];
+
+        grid.candidate_counts[static_cast<size_t>(i)] = ocr->recognize_candidates_at(cut_frame, grid.digit_areas[static_cast<size_t>(i)], cell_candidates, max_candidates);
+
+        number = cell_candidates[0].number;
 
         if(number == 0)
         {
@@ -211,35 +869,185 @@ bool VideoSudoku::recognize_number()
 
         if(count < 17) return false;
 
-        input_problem[i] = static_cast<char>(number) + '0';
+        grid.input_problem[static_cast<size_t>(i)] = static_cast<char>(number) + '0';
     }
 
-    input_problem[all_cells_number + 1] = '\0';
+    grid.input_problem[all_cells_number] = '\0';
 
     return true;
 }
 
+void VideoSudoku::convert_gray(const Mat &color_frame, Mat &gray_frame) const
+{
+    if(gray_conversion < 0)
+    {
+        color_frame.copyTo(gray_frame);
+    }
+    else
+    {
+        cvtColor(color_frame, gray_frame, gray_conversion);
+    }
+}
+
 void VideoSudoku::frame_initialize(Mat &frame, const int size) const
 {
-    frame = Mat(Size(size, size), CV_8UC3, frame_background_color);
+    frame.create(size, size, CV_8UC3);
+    frame.setTo(frame_background_color);
 }
 
-bool VideoSudoku::is_sudoku_contour()
+void VideoSudoku::prepare_buffers(const Size &frame_size)
 {
-    if(contour.size() != 4) return false;
+    const auto level = detection_level(frame_size);
+    const Size detect_size = {frame_size.width >> level, frame_size.height >> level};
 
-    if(!isContourConvex(contour)) return false;
+    buffer_size = frame_size;
 
-    auto contour_area = contourArea(contour);
-    auto temp_frame_area = temp_frame.rows * temp_frame.cols;
+    // 入力画像のサイズが変わった場合は、変化の有無に関わらず次の画像を処理する。
+    gate_color.create(gate_thumbnail_height, gate_thumbnail_width, CV_8UC3);
+    gate_thumbnail.create(gate_thumbnail_height, gate_thumbnail_width, CV_8UC1);
+    gate_reference.release();
 
-    if(contour_area >= temp_frame_area / 2) return false;
+    input_gray_frame.create(frame_size, CV_8UC1);
+
+    if(level > 0)
+    {
+        scaled_gray_frame.create(detect_size, CV_8UC1);
+    }
+    else
+    {
+        scaled_gray_frame.release();
+    }
+
+    detect_frame.create(detect_size, CV_8UC1);
+
+    // 追跡の探索窓は入力画像のグレースケール画像を参照するため、保存する前の画像の窓だけを確保する。
+    corner_patches.resize(corners_number);
+
+    for(auto &patch: corner_patches)
+    {
+        patch.create(2 * track_radius + 1, 2 * track_radius + 1, CV_8UC1);
+    }
+}
+
+bool VideoSudoku::is_sudoku_contour(const vector<Point> &frame_contour) const
+{
+    if(frame_contour.size() != 4) return false;
+
+    if(!isContourConvex(frame_contour)) return false;
+
+    // 作業用画像は処理の段階によってサイズが変わるため、入力画像の面積と比べる。
+    auto contour_area = contourArea(frame_contour);
+    auto input_frame_area = input_frame.rows * input_frame.cols;
+
+    if(contour_area >= input_frame_area / 2) return false;
 
     return true;
 }
 
-void VideoSudoku::draw_result()
+void VideoSudoku::prepare_result_layers()
+{
+    frame_initialize(grid_background, result_size);
+    draw_cell(grid_background);
+
+    // 各マスの枠線は左端と上端だけにあるため、左上のマスの背景に数字を描けば、どのマスにもそのまま複写できる。
+    const Mat cell_background = {grid_background, Rect(0, 0, cell_size, cell_size)};
+    const Point position = {text_offset, cell_size - text_offset};
+    const Scalar colors[] = {initial_text_color, result_text_color};
+
+    glyph_atlas.create(cell_size * 2, cell_size * cells_number, CV_8UC3);
+
+    for(auto row = 0; row < 2; ++row)
+    {
+        for(auto digit = 0; digit < cells_number; ++digit)
+        {
+            Mat glyph = {glyph_atlas, Rect(digit * cell_size, row * cell_size, cell_size, cell_size)};
+
+            cell_background.copyTo(glyph);
+            putText(glyph, {1, static_cast<char>('1' + digit)}, position, FONT_HERSHEY_SIMPLEX, 1, colors[row], 3);
+        }
+    }
+
+    // 結果画像のサイズが変わったため、次は必ず書き込み直す。
+    drawn_key.clear();
+}
+
+void VideoSudoku::draw_results()
+{
+    // 盤面ごとに結果画像の一辺の長さの正方形を横に並べる。数独が無い場合は空の盤面を1つ描く。
+    const auto tiles = max(grid_count, 1);
+
+    // 解けた盤面の初期値と解だけで結果画像が決まるため、それが前回と同じであれば書き込み直さない。
+    result_key.assign(static_cast<size_t>(tiles * all_cells_number * 2), '\0');
+
+    for(auto i = 0; i < grid_count; ++i)
+    {
+        const auto &grid = grids[static_cast<size_t>(i)];
+
+        if(grid.outcome != OUTCOME_SOLVED) continue;
+
+        const auto key = result_key.begin() + i * all_cells_number * 2;
+
+        copy(grid.input_problem.begin(), grid.input_problem.begin() + all_cells_number, key);
+        copy(grid.result_problem.begin(), grid.result_problem.begin() + all_cells_number, key + all_cells_number);
+    }
+
+    if(result_key == drawn_key && result_frame.cols == result_size * tiles) return;
+
+    drawn_key.swap(result_key);
+
+    result_frame.create(result_size, result_size * tiles, CV_8UC3);
+
+    for(auto i = 0; i < tiles; ++i)
+    {
+        Mat tile = {result_frame, Rect(i * result_size, 0, result_size, result_size)};
+
+        grid_background.copyTo(tile);
+
+        if(i < grid_count && grids[static_cast<size_t>(i)].outcome == OUTCOME_SOLVED)
+        {
+            draw_result(grids[static_cast<size_t>(i)], tile);
+        }
+    }
+}
+
+void VideoSudoku::draw_result(const SudokuGrid &grid, Mat &tile) const
+{
+    for(auto i = 0; i < all_cells_number; ++i)
+    {
+        const auto input = grid.input_problem[static_cast<size_t>(i)];
+        const auto result = grid.result_problem[static_cast<size_t>(i)];
+
+        // 結果には初期値も含まれているため、初期値のマスは初期値の色で描く。空白のマスは背景のままにする。
+        const auto given = input >= '1' && input <= '9';
+        const auto digit = given ? input : result;
+
+        if(digit < '1' || digit > '9') continue;
+
+        const Rect glyph_area = {(digit - '1') * cell_size, given ? 0 : cell_size, cell_size, cell_size};
+        const Rect cell_area = {(i % cells_number) * cell_size, (i / cells_number) * cell_size, cell_size, cell_size};
+
+        Mat cell = {tile, cell_area};
+
+        Mat(glyph_atlas, glyph_area).copyTo(cell);
+    }
+}
+
+void VideoSudoku::render_overlay(SudokuGrid &grid) const
 {
+    auto &rendered = grid.overlay_problem;
+
+    const auto input_begin = grid.input_problem.begin();
+    const auto result_begin = grid.result_problem.begin();
+
+    // 追跡中は同じ解が続くため、前回描いた初期値と解から変わっていなければ描き直さない。
+    if(equal(input_begin, input_begin + all_cells_number, rendered.begin()) && equal(result_begin, result_begin + all_cells_number, rendered.begin() + all_cells_number)) return;
+
+    copy(input_begin, input_begin + all_cells_number, rendered.begin());
+    copy(result_begin, result_begin + all_cells_number, rendered.begin() + all_cells_number);
+
+    grid.overlay_digits.setTo(Scalar::all(0));
+    grid.overlay_mask.setTo(Scalar::all(0));
+
     Point position;
 
     for(auto i = 0; i < all_cells_number; ++i)
@@ -247,23 +1055,38 @@ void VideoSudoku::draw_result()
         position.x = ((i % cells_number) * cell_size) + text_offset;
         position.y = ((1 + (i / cells_number)) * cell_size) - text_offset;
 
-        const auto input = input_problem[i];
-        const auto result = result_problem[i];
+        const auto input = grid.input_problem[static_cast<size_t>(i)];
+        const auto result = grid.result_problem[static_cast<size_t>(i)];
 
-        // 結果には初期値も含まれているため、初期値は結果の上から描画する。
-        if(result >= '1' && result <= '9')
-        {
-            putText(result_frame, {1, result}, position, FONT_HERSHEY_SIMPLEX, 1, result_text_color, 3);
-        }
+        // 初期値は紙面に印刷されているため、空いていたマスの数字だけを重ねる。
+        if(result < '1' || result > '9' || (input >= '1' && input <= '9')) continue;
 
-        if(input >= '1' && input <= '9')
-        {
-            putText(result_frame, {1, input}, position, FONT_HERSHEY_SIMPLEX, 1, initial_text_color, 3);
-        }
+        putText(grid.overlay_digits, {1, result}, position, FONT_HERSHEY_SIMPLEX, 1, result_text_color, 3);
+        putText(grid.overlay_mask, {1, result}, position, FONT_HERSHEY_SIMPLEX, 1, Scalar::all(pixel_max_value), 3);
     }
 }
 
-void VideoSudoku::draw_cell()
+void VideoSudoku::draw_overlay(Mat &frame, const vector<Point> &frame_contour, const Mat &digits, const Mat &mask)
+{
+    if(frame_contour.size() != corners_number || digits.empty()) return;
+
+    // 入力画像全体ではなく、数独の外接矩形だけを射影して重ねる。
+    const auto roi = boundingRect(frame_contour) & Rect(0, 0, frame.cols, frame.rows);
+
+    if(roi.area() <= 0) return;
+
+    // 盤面の座標から入力画像の座標への変換 (歪み補正の逆変換) に、外接矩形の原点への平行移動を加える。
+    const auto transform = Matx33d(1, 0, -roi.x, 0, 1, -roi.y, 0, 0, 1) * get_grid_transform(frame_contour);
+
+    warpPerspective(digits, overlay_roi_digits, transform, roi.size(), INTER_LINEAR, BORDER_CONSTANT);
+    warpPerspective(mask, overlay_roi_mask, transform, roi.size(), INTER_NEAREST, BORDER_CONSTANT);
+
+    Mat frame_roi = {frame, roi};
+
+    overlay_roi_digits.copyTo(frame_roi, overlay_roi_mask);
+}
+
+void VideoSudoku::draw_cell(Mat &tile) const
 {
     Point pt1, pt2;
 
@@ -275,7 +1098,7 @@ void VideoSudoku::draw_cell()
         pt2.x = cell_size * i;
         pt2.y = result_size;
 
-        line(result_frame, pt1, pt2, cell_line_color, 1);
+        line(tile, pt1, pt2, cell_line_color, 1);
     }
 
     // 横線を描く。
@@ -286,75 +1109,36 @@ void VideoSudoku::draw_cell()
         pt2.x = result_size;
         pt2.y = cell_size * i;
 
-        line(result_frame, pt1, pt2, cell_line_color, 1);
+        line(tile, pt1, pt2, cell_line_color, 1);
     }
 }
 
-void VideoSudoku::make_binary_frame(Mat &target_frame, const int threshold_type) const
+void VideoSudoku::make_binary_frame(MeanThreshold &threshold, const Mat &gray_frame, Mat &binary_frame, const int threshold_type) const
 {
-    cvtColor(target_frame, target_frame, COLOR_RGB2GRAY);
-    adaptiveThreshold(target_frame, target_frame, pixel_max_value, ADAPTIVE_THRESH_MEAN_C, threshold_type, thresh_block_size, thresh_const);
+    // adaptiveThreshold (ADAPTIVE_THRESH_MEAN_C) と同じ結果を、積分画像の作業領域を再利用して求める。
+    threshold.apply(gray_frame, binary_frame, pixel_max_value, threshold_type, thresh_block_size, thresh_const);
 }
 
-bool VideoSudoku::get_outer_contour()
+Matx33d VideoSudoku::get_grid_transform(const vector<Point> &frame_contour) const
 {
-    auto max_area_contour = 0u;
-    auto max_area = 0.0;
-
-    vector<vector<Point>> contours;
-
-    findContours(temp_frame, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
-
-    if(contours.empty()) return false;
+    Point2d quad[corners_number];
 
-    const auto size = contours.size();
+    // 結果画像の頂点と輪郭の頂点を対応させる。
+    // 輪郭の頂点0と頂点2のx座標の関係によって、頂点の対応を変更する。
+    const auto first = frame_contour[0].x < frame_contour[2].x ? 0 : 1;
 
-    for(auto i = 0u; i < size; ++i)
+    // 単位正方形の頂点 (0,0) (1,0) (1,1) (0,1) は、輪郭の頂点を逆順にたどった順になる。
+    for(auto i = 0; i < corners_number; ++i)
     {
-        auto area = contourArea(contours[i]);
-
-        if(max_area < area)
-        {
-            max_area = area;
-            max_area_contour = i;
-        }
+        quad[i] = frame_contour[static_cast<size_t>((first - i + corners_number) % corners_number)];
     }
 
-    contour = contours[max_area_contour];
-
-    return true;
-}
-
-Mat VideoSudoku::get_homography(const vector<Point> &frame_contour, const Rect &bound_rect) const
-{
-    const auto x = bound_rect.x;
-    const auto y = bound_rect.y;
-    const auto width = bound_rect.width;
-    const auto height = bound_rect.height;
-
-    vector<Point> corner_contour;
-
-    // 矩形と輪郭の頂点を対応させる。
-    // 輪郭の頂点0と頂点2のx座標の関係によって、矩形の頂点指定順を変更する。
-    if(contour[0].x < contour[2].x)
-    {
-        corner_contour.push_back({x, y});
-        corner_contour.push_back({x, y + height});
-        corner_contour.push_back({x + width, y + height});
-        corner_contour.push_back({x + width, y});
-    }
-    else
-    {
-        corner_contour.push_back({x + width, y});
-        corner_contour.push_back({x, y});
-        corner_contour.push_back({x, y + height});
-        corner_contour.push_back({x + width, y + height});
-    }
+    const auto scale = 1.0 / result_size;
 
-    return findHomography(frame_contour, corner_contour);
+    return square_to_quad(quad) * Matx33d(scale, 0, 0, 0, scale, 0, 0, 0, 1);
 }
 
-void VideoSudoku::delete_grid()
+void VideoSudoku::delete_grid(Mat &binary_frame) const
 {
     const auto line_thickness = (12 * result_size) / 500;
 
@@ -368,7 +1152,7 @@ void VideoSudoku::delete_grid()
         pt2.x = cell_size * i;
         pt2.y = result_size;
 
-        line(temp_frame, pt1, pt2, frame_background_color, line_thickness);
+        line(binary_frame, pt1, pt2, frame_background_color, line_thickness);
     }
 
     // 横線を削る。
@@ -379,13 +1163,38 @@ void VideoSudoku::delete_grid()
         pt2.x = result_size;
         pt2.y = cell_size * i;
 
-        line(temp_frame, pt1, pt2, frame_background_color, line_thickness);
+        line(binary_frame, pt1, pt2, frame_background_color, line_thickness);
     }
 }
 
-bool VideoSudoku::sudoku_solve()
+void VideoSudoku::lap(const SudokuStage stage)
 {
-    const auto result_code = solve_dlx_sudoku(input_problem, result_problem);
+    const auto now = chrono::steady_clock::now();
+
+    // 追跡に失敗して抽出し直した場合など、同じ段階を2度通った時間は合計する。
+    stage_times[stage] += elapsed_us(stage_mark, now);
+    stage_mark = now;
+}
+
+bool VideoSudoku::sudoku_solve(SudokuGrid &grid) const
+{
+    const auto input_problem = grid.input_problem.data();
+    const auto result_problem = grid.result_problem.data();
+
+    auto result_code = solve_dlx_sudoku(input_problem, result_problem);
+
+    // 1マスの誤認識で解けなくなるため、認識候補から作った別の問題を試す。
+    // 複数の盤面を並列に処理している場合は、スレッドを盤面の数で分け合う。
+    if(result_code != 1)
+    {
+        const auto hardware_threads = static_cast<int>(thread::hardware_concurrency()) / max(grid_count, 1);
+        const CandidateBudget budget = {max_hypotheses, max(1, min(hardware_threads, max_hypotheses_threads)), chrono::microseconds(hypotheses_time_us), grid.hypothesis_pool.get()};
+
+        if(solve_candidates(grid.candidates.data(), grid.candidate_counts.data(), max_candidates, budget, input_problem, result_problem))
+        {
+            result_code = 2;
+        }
+    }
 
 #ifdef VIDEOSUDOKU_DEBUG
     DEBUG(" input  : %s", input_problem);
@@ -393,6 +1202,6 @@ bool VideoSudoku::sudoku_solve()
     DEBUG(" code   : %d", result_code);
 #endif
 
-    return result_code == 1;
+    return result_code != 0;
 }
 }
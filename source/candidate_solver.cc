@@ -0,0 +1,215 @@
+//!
+//! @file  candidate_solver.cc
+//! @brief candidate_solver モジュール実装
+//!
+
+#include "candidate_solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include "dlx_sudoku.h"
+#include "worker_pool.h"
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto cells_number = 81; //!< 全てのマスの数
+
+constexpr auto min_givens = 17; //!< 数独の初期値の最小数
+
+constexpr auto max_substitutions = 12; //!< 仮説の組み合わせに使う置き換えの最大数
+
+constexpr auto max_hypotheses = max_substitutions + max_substitutions * (max_substitutions - 1) / 2; //!< 置き換えから作る仮説の最大数
+
+constexpr auto min_confidence = 1e-6; //!< 対数を取る際の確度の下限
+
+//! @brief 1マスの候補の置き換え
+struct Substitution
+{
+    int cell;    //!< マスの位置
+    char number; //!< 置き換える文字 ('0'-'9')
+    double cost; //!< 第1候補からの対数尤度の低下
+};
+
+//! @brief 仮説 (置き換えの組み合わせ)
+struct Hypothesis
+{
+    int first;   //!< 1つ目の置き換え
+    int second;  //!< 2つ目の置き換え (無い場合は -1)
+    double cost; //!< 対数尤度の低下の合計
+};
+
+//! @brief  問題の初期値の数を数える
+//! @param  problem 問題
+//! @return 初期値の数
+int count_givens(const char *problem)
+{
+    return static_cast<int>(count_if(problem, problem + cells_number, [](const char c) { return c >= '1' && c <= '9'; }));
+}
+
+//! @brief 置き換えを対数尤度の低下の小さい順に max_substitutions 個まで残す
+//! @param substitutions 残した置き換え (対数尤度の低下の昇順)
+//! @param size          残した置き換えの数
+//! @param substitution  追加する置き換え
+void insert(Substitution *substitutions, int &size, const Substitution &substitution)
+{
+    if(size == max_substitutions && !(substitution.cost < substitutions[size - 1].cost)) return;
+
+    // 同じ低下の置き換えは先に追加したものを前に置く。
+    auto position = min(size, max_substitutions - 1);
+
+    for(; position > 0 && substitution.cost < substitutions[position - 1].cost; --position)
+    {
+        substitutions[position] = substitutions[position - 1];
+    }
+
+    substitutions[position] = substitution;
+
+    size = min(size + 1, max_substitutions);
+}
+
+//! @brief  仮説を問題に適用する
+//! @param  substitutions 置き換え
+//! @param  hypothesis    仮説
+//! @param  problem       問題
+//! @retval true          仮説にマスを空白にする置き換えが含まれる
+//! @retval false         含まれない
+bool apply(const Substitution *substitutions, const Hypothesis &hypothesis, char *problem)
+{
+    const auto &first = substitutions[hypothesis.first];
+
+    problem[first.cell] = first.number;
+
+    if(hypothesis.second < 0) return first.number == '0';
+
+    const auto &second = substitutions[hypothesis.second];
+
+    problem[second.cell] = second.number;
+
+    return first.number == '0' || second.number == '0';
+}
+}
+
+namespace videosudoku
+{
+bool solve_candidates(const DigitCandidate *candidates, const int *counts, const int max_candidates, const CandidateBudget &budget, char *problem, char *result)
+{
+    // 置き換えと仮説は上限の数が決まっているため、呼び出しごとに確保せずスタック上の配列に詰める。
+    Substitution substitutions[max_substitutions];
+    Hypothesis hypotheses[max_hypotheses];
+
+    auto nr_substitutions = 0;
+
+    for(auto cell = 0; cell < cells_number; ++cell)
+    {
+        const auto cell_candidates = candidates + cell * max_candidates;
+        const auto top = log(max(cell_candidates[0].confidence, min_confidence));
+
+        for(auto rank = 1; rank < counts[cell]; ++rank)
+        {
+            const auto cost = top - log(max(cell_candidates[rank].confidence, min_confidence));
+
+            insert(substitutions, nr_substitutions, {cell, static_cast<char>('0' + cell_candidates[rank].number), cost});
+        }
+    }
+
+    if(nr_substitutions == 0 || budget.max_hypotheses <= 0) return false;
+
+    // 1か所の置き換えと、異なるマスの2か所の置き換えを尤もらしい順に並べる。
+    auto nr_hypotheses = 0;
+
+    for(auto i = 0; i < nr_substitutions; ++i)
+    {
+        hypotheses[nr_hypotheses++] = {i, -1, substitutions[i].cost};
+
+        for(auto j = i + 1; j < nr_substitutions; ++j)
+        {
+            if(substitutions[i].cell == substitutions[j].cell) continue;
+
+            hypotheses[nr_hypotheses++] = {i, j, substitutions[i].cost + substitutions[j].cost};
+        }
+    }
+
+    // 作業領域を確保しないように、同じ低下の仮説は作った順 (置き換えの番号順) に並べて安定な整列と同じ順にする。
+    sort(hypotheses, hypotheses + nr_hypotheses, [](const Hypothesis &a, const Hypothesis &b)
+    {
+        if(a.cost != b.cost) return a.cost < b.cost;
+        if(a.first != b.first) return a.first < b.first;
+
+        return a.second < b.second;
+    });
+
+    nr_hypotheses = min(nr_hypotheses, budget.max_hypotheses);
+
+    const auto deadline = chrono::steady_clock::now() + budget.time;
+
+    atomic<int> next(0);
+    atomic<int> best(nr_hypotheses);
+
+    mutex best_lock;
+
+    char best_problem[cells_number + 1];
+    char best_result[cells_number + 1];
+
+    // 仮説を順に取り出して解く。より尤もらしい仮説が解けている場合や、時間の上限を過ぎた場合は打ち切る。
+    auto worker = [&]()
+    {
+        char hypothesis_problem[cells_number + 1];
+        char hypothesis_result[cells_number + 1];
+
+        for(auto index = next++; index < best && chrono::steady_clock::now() < deadline; index = next++)
+        {
+            memcpy(hypothesis_problem, problem, cells_number);
+            hypothesis_problem[cells_number] = '\0';
+
+            const auto blanked = apply(substitutions, hypotheses[index], hypothesis_problem);
+
+            if(count_givens(hypothesis_problem) < min_givens) continue;
+
+            // 初期値を空白にすると解が複数になりうるため、解が1つに決まる場合だけ採用する。
+            if(blanked)
+            {
+                if(count_dlx_sudoku(hypothesis_problem, hypothesis_result, 2) != 1) continue;
+            }
+            else if(solve_dlx_sudoku(hypothesis_problem, hypothesis_result) != 1)
+            {
+                continue;
+            }
+
+            lock_guard<mutex> guard(best_lock);
+
+            if(index < best)
+            {
+                best = index;
+
+                memcpy(best_problem, hypothesis_problem, sizeof(best_problem));
+                memcpy(best_result, hypothesis_result, sizeof(best_result));
+            }
+        }
+    };
+
+    const auto nr_threads = max(1, min(budget.max_threads, nr_hypotheses));
+
+    if(budget.pool != nullptr)
+    {
+        budget.pool->run(nr_threads, [&](int) { worker(); });
+    }
+    else
+    {
+        worker();
+    }
+
+    if(best >= nr_hypotheses) return false;
+
+    memcpy(problem, best_problem, cells_number);
+    memcpy(result, best_result, cells_number + 1);
+
+    return true;
+}
+}
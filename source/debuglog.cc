@@ -0,0 +1,298 @@
+//!
+//! @file  debuglog.cc
+//! @brief debuglog モジュール実装
+//!
+
+#include "debuglog.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr size_t ring_capacity = 1024; //!< 環状バッファに保持できるログの数 (2の累乗)
+constexpr size_t line_size = 1024;     //!< 書式化した1行の最大の長さ (これを超える部分は切り捨てる)
+
+//! @brief 環状バッファの要素
+struct LogSlot
+{
+    atomic<size_t> sequence; //!< 書き込み済みかどうかを表す番号 (書き込み待ち:位置 書き込み済み:位置 + 1)
+    LogRecord record;        //!< ログ
+};
+
+//! @brief  レベルの表示名を取得する
+//! @param  level レベル
+//! @return 表示名
+const char *level_label(const LogLevel level)
+{
+    switch(level)
+    {
+    case LOG_LEVEL_ERROR:
+        return "ERROR";
+    case LOG_LEVEL_LOG:
+        return "LOG";
+    case LOG_LEVEL_DEBUG:
+        return "DEBUG";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+//! @brief 複数のスレッドから書き込まれたログを、バックグラウンドのスレッドで書式化して出力するクラス
+//!
+//! 環状バッファは要素ごとの番号で書き込み済みかどうかを表す多対1のロックフリーのキューで、
+//! 書き込む側は位置を1つ進める比較交換だけでログの領域を確保する。満杯の場合はログを捨てて数だけを数える。
+//! バックグラウンドのスレッドは環状バッファが空になると条件変数で眠り、書き込む側は眠っている場合だけ起こす。
+class LogWriter final
+{
+public:
+    //! @brief コンストラクタ (バックグラウンドのスレッドを開始する)
+    LogWriter(): slots(ring_capacity)
+    {
+        for(auto i = 0u; i < ring_capacity; ++i)
+        {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+
+        writer = thread(&LogWriter::write_loop, this);
+    }
+
+    //! @brief デストラクタ (書き込み済みのログをすべて出力してからスレッドを停止する)
+    ~LogWriter()
+    {
+        running.store(false, memory_order_release);
+        wake_writer();
+        writer.join();
+    }
+
+    LogWriter(const LogWriter &) = delete;
+    LogWriter &operator=(const LogWriter &) = delete;
+
+    //! @brief  環状バッファの空きを取得する
+    //! @param  position 取得した位置の書き出し先
+    //! @retval nullptr 環状バッファが満杯
+    //! @return others  書き込むログ
+    LogRecord *acquire(size_t &position)
+    {
+        auto tail = write_position.load(memory_order_relaxed);
+
+        while(true)
+        {
+            auto &slot = slots[tail & (ring_capacity - 1)];
+
+            const auto difference = static_cast<ptrdiff_t>(slot.sequence.load(memory_order_acquire)) - static_cast<ptrdiff_t>(tail);
+
+            if(difference == 0)
+            {
+                if(write_position.compare_exchange_weak(tail, tail + 1, memory_order_relaxed))
+                {
+                    position = tail;
+
+                    return &slot.record;
+                }
+            }
+            else if(difference < 0)
+            {
+                // 出力が追いついていない。呼び出し元を待たせないように捨てる。
+                dropped.fetch_add(1, memory_order_relaxed);
+
+                return nullptr;
+            }
+            else
+            {
+                tail = write_position.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    //! @brief 書き込んだログをバックグラウンドのスレッドに渡す
+    //! @param position acquire で取得した位置
+    void commit(const size_t position)
+    {
+        slots[position & (ring_capacity - 1)].sequence.store(position + 1, memory_order_release);
+
+        // 空の環状バッファに書き込んだ場合だけ起こす。眠っていなければロックを取らない。
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if(parked.load(memory_order_relaxed))
+        {
+            wake_writer();
+        }
+    }
+
+private:
+    //! @brief バックグラウンドのスレッド
+    void write_loop()
+    {
+        char line[line_size];
+
+        auto reported = 0L;
+
+        while(true)
+        {
+            // 停止の要求を確認してから残りを出力することで、デストラクタまでに書き込まれたログを取りこぼさない。
+            const auto stopping = !running.load(memory_order_acquire);
+
+            auto written = false;
+
+            while(write_next(line))
+            {
+                written = true;
+            }
+
+            const auto dropped_count = dropped.load(memory_order_relaxed);
+
+            if(dropped_count != reported)
+            {
+                fprintf(stderr, "[LOG] %s(%d) : %ld log records were dropped.\n", __FUNCTION__, __LINE__, dropped_count - reported);
+
+                reported = dropped_count;
+                written = true;
+            }
+
+            if(written)
+            {
+                fflush(stderr);
+            }
+
+            if(stopping) return;
+
+            if(!written)
+            {
+                park(reported);
+            }
+        }
+    }
+
+    //! @brief 書き込まれるか停止を要求されるまで眠る
+    //! @param reported 報告済みの捨てたログの数
+    void park(const long reported)
+    {
+        unique_lock<mutex> guard(wake_lock);
+
+        parked.store(true, memory_order_relaxed);
+
+        // 眠ることを示してから確認し直し、確認の前に書き込まれたログの通知を取りこぼさない。
+        atomic_thread_fence(memory_order_seq_cst);
+
+        const auto pending = slots[read_position & (ring_capacity - 1)].sequence.load(memory_order_acquire) == read_position + 1;
+
+        if(!pending && dropped.load(memory_order_relaxed) == reported && running.load(memory_order_acquire))
+        {
+            wake.wait(guard, [this] { return !parked.load(memory_order_relaxed); });
+        }
+
+        parked.store(false, memory_order_relaxed);
+    }
+
+    //! @brief 眠っているバックグラウンドのスレッドを起こす
+    void wake_writer()
+    {
+        {
+            lock_guard<mutex> guard(wake_lock);
+
+            parked.store(false, memory_order_relaxed);
+        }
+
+        wake.notify_one();
+    }
+
+    //! @brief  次のログを書式化して出力する
+    //! @param  line 書式化の作業領域 (line_size 文字)
+    //! @retval true  出力した
+    //! @retval false 環状バッファが空
+    bool write_next(char *line)
+    {
+        auto &slot = slots[read_position & (ring_capacity - 1)];
+
+        if(slot.sequence.load(memory_order_acquire) != read_position + 1) return false;
+
+        const auto &record = slot.record;
+
+        auto length = snprintf(line, line_size, "[%s] %s(%d) : ", level_label(record.level), record.function, record.line);
+
+        length = min(max(length, 0), static_cast<int>(line_size) - 1);
+
+        record.formatter(line + length, line_size - static_cast<size_t>(length), record.format, record.payload);
+
+        // ヘッドレスモードは標準出力に結果のレコードを書き出すため、ログは混ざらないように標準エラー出力に出す。
+        // 標準エラー出力はバッファリングされないため、他の出力と行の途中で混ざらないように改行まで1回で書き込む。
+        const auto line_length = min(strlen(line), line_size - 2);
+
+        line[line_length] = '\n';
+        fwrite(line, 1, line_length + 1, stderr);
+
+        // 書き込む側がこの要素を次に使えるのは、環状バッファを1周した位置になる。
+        slot.sequence.store(read_position + ring_capacity, memory_order_release);
+        ++read_position;
+
+        return true;
+    }
+
+    vector<LogSlot> slots; //!< 環状バッファ
+
+    alignas(64) atomic<size_t> write_position{0}; //!< 書き込む側が次に確保する位置
+    alignas(64) size_t read_position = 0;         //!< バックグラウンドのスレッドが次に出力する位置
+
+    atomic<long> dropped{0};     //!< 環状バッファが満杯で捨てたログの数
+    atomic<bool> running{true}; //!< バックグラウンドのスレッドを動かすかどうか
+
+    mutex wake_lock;            //!< parked と wake の排他制御
+    condition_variable wake;    //!< バックグラウンドのスレッドを起こす通知
+    atomic<bool> parked{false}; //!< バックグラウンドのスレッドが眠っているかどうか
+
+    thread writer; //!< バックグラウンドのスレッド
+};
+
+//! @brief  ログを出力するオブジェクトを取得する (最初に書き込まれたときにスレッドを開始する)
+//! @return オブジェクト
+LogWriter &log_writer()
+{
+    static LogWriter writer;
+
+    return writer;
+}
+}
+
+namespace videosudoku
+{
+atomic<int> current_log_level{LOG_LEVEL_DEBUG};
+
+void set_log_level(const LogLevel level)
+{
+    current_log_level.store(level, memory_order_relaxed);
+}
+
+bool parse_log_level(const char *name, LogLevel &level)
+{
+    static const char *const names[] = {"none", "error", "log", "debug"};
+
+    for(auto i = 0; i <= LOG_LEVEL_DEBUG; ++i)
+    {
+        if(strcmp(name, names[i]) == 0)
+        {
+            level = static_cast<LogLevel>(i);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+LogRecord *acquire_log_record(size_t &position)
+{
+    return log_writer().acquire(position);
+}
+
+void commit_log_record(const size_t position)
+{
+    log_writer().commit(position);
+}
+}
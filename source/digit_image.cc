@@ -0,0 +1,132 @@
+//!
+//! @file  digit_image.cc
+//! @brief digit_image モジュール実装
+//!
+
+#include "digit_image.h"
+
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+using namespace cv;
+using namespace std;
+}
+
+namespace videosudoku
+{
+bool is_digit_area(const Rect &area, const Size &cell_size)
+{
+    if(area.x < cell_size.width * 5 / 100 || area.y < cell_size.height * 5 / 100) return false;
+
+    if(area.width < cell_size.width / 10 || area.height < cell_size.height * 4 / 10) return false;
+
+    return true;
+}
+
+Rect find_digit_area(const Mat &src)
+{
+    vector<vector<Point>> contours;
+    vector<Vec4i> hierarchy;
+    Rect rect;
+
+    auto area = 0.0;
+
+    findContours(src.clone(), contours, hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
+
+    auto max_area = 0.0;
+    auto max_area_index = -1l;
+
+    for(auto i = 0u; i < contours.size(); ++i)
+    {
+        rect = boundingRect(contours[i]);
+
+        if(!is_digit_area(rect, src.size()))
+        {
+            continue;
+        }
+
+        area = contourArea(contours[i]);
+
+        if(area > max_area)
+        {
+            max_area = area;
+            max_area_index = static_cast<long>(i);
+        }
+    }
+
+    if(max_area_index < 0) return Rect();
+
+    return boundingRect(contours[static_cast<unsigned long>(max_area_index)]);
+}
+
+void crop_digit(const Mat &src, const Rect &digit_area, Mat &dst)
+{
+    if(digit_area.area() > 0)
+    {
+        auto x = digit_area.x + (digit_area.width / 2) - (digit_area.height / 2);
+
+        if(x < 0)
+        {
+            x = 0;
+        }
+
+        const auto w = x + digit_area.height > src.cols ? src.cols - x : digit_area.height;
+
+        dst = src({x, digit_area.y, w, digit_area.height});
+    }
+    else
+    {
+        dst = src({src.cols * 5 / 100, src.rows * 5 / 100, src.cols * 9 / 10, src.rows * 9 / 10});
+    }
+}
+
+void normalize_digit(const Mat &src, Mat &dst)
+{
+    crop_digit(src, find_digit_area(src), dst);
+}
+
+void DigitLocator::locate(const Mat &grid, const int cells_number, const int cell_size, vector<Rect> &digit_areas)
+{
+    const auto all_cells_number = static_cast<size_t>(cells_number * cells_number);
+    const Size cell = {cell_size, cell_size};
+
+    digit_areas.assign(all_cells_number, Rect());
+    max_areas.assign(all_cells_number, 0);
+
+    // 数字は黒で描かれているため、反転して前景にする。
+    bitwise_not(grid, inverted);
+
+    const auto count = connectedComponentsWithStats(inverted, labels, stats, centroids, 8, CV_32S);
+
+    for(auto label = 1; label < count; ++label)
+    {
+        const auto stat = stats.ptr<int>(label);
+        const Rect box = {stat[CC_STAT_LEFT], stat[CC_STAT_TOP], stat[CC_STAT_WIDTH], stat[CC_STAT_HEIGHT]};
+
+        // 外接矩形の中心が含まれるマスに割り当てる。
+        const auto col = (box.x + box.width / 2) / cell_size;
+        const auto row = (box.y + box.height / 2) / cell_size;
+
+        if(col >= cells_number || row >= cells_number) continue;
+
+        const Point origin = {col * cell_size, row * cell_size};
+
+        // マスごとに輪郭を追跡した場合と同じく、マスからはみ出した部分は切り捨てる。
+        auto area = box & Rect(origin, cell);
+
+        area.x -= origin.x;
+        area.y -= origin.y;
+
+        if(!is_digit_area(area, cell)) continue;
+
+        const auto index = static_cast<size_t>(row * cells_number + col);
+
+        if(stat[CC_STAT_AREA] > max_areas[index])
+        {
+            max_areas[index] = stat[CC_STAT_AREA];
+            digit_areas[index] = area;
+        }
+    }
+}
+}
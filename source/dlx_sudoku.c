@@ -72,6 +72,28 @@ static int to_sudoku_num(const int row_index)
     return row_index % N;
 }
 
+//! @brief 解の数を数えるときのコールバック関数の引数
+typedef struct
+{
+    char *results; //!< 最初に見つけた数独の解の配列
+    int nfound;    //!< 見つけた解の数
+    int limit;     //!< 探索を打ち切る解の数
+} count_dlx_sudoku_param_t;
+
+//! @brief DLXで解いた数独の解を配列に詰める
+//! @param nsolution DLXでの解の数
+//! @param solutions DLXでの解の配列
+//! @param results   数独の解の配列
+static void set_dlx_sudoku_result(int nsolution, const int *solutions, char *results)
+{
+    for(int solution_i = 0; solution_i < nsolution; ++solution_i)
+    {
+        const int dlx_row_index = solutions[solution_i];
+
+        results[to_sudoku_cell(dlx_row_index)] = (char)(to_sudoku_num(dlx_row_index) + '1');
+    }
+}
+
 //! @brief  DLXで解いた数独の解を配列に詰める
 //! @param  nsolution       DLXでの解の数
 //! @param  solutions       DLXでの解の配列
@@ -79,16 +101,29 @@ static int to_sudoku_num(const int row_index)
 //! @return 常に1を返す
 static int solve_dlx_sudoku_cb(int nsolution, int *solutions, void *solved_cb_param)
 {
-    char *results = (char*)solved_cb_param;
+    set_dlx_sudoku_result(nsolution, solutions, (char*)solved_cb_param);
 
-    for(int solution_i = 0; solution_i < nsolution; ++solution_i)
-    {
-        const int dlx_row_index = solutions[solution_i];
+    return 1;
+}
 
-        results[to_sudoku_cell(dlx_row_index)] = (char)(to_sudoku_num(dlx_row_index) + '1');
+//! @brief  DLXで解いた数独の解を数え、最初の解を配列に詰める
+//! @param  nsolution       DLXでの解の数
+//! @param  solutions       DLXでの解の配列
+//! @param  solved_cb_param count_dlx_sudoku_param_t
+//! @retval 0               探索を続ける (上限の数の解をまだ見つけていない)
+//! @retval 1               探索を打ち切る
+static int count_dlx_sudoku_cb(int nsolution, int *solutions, void *solved_cb_param)
+{
+    count_dlx_sudoku_param_t *param = (count_dlx_sudoku_param_t*)solved_cb_param;
+
+    if(param->nfound == 0)
+    {
+        set_dlx_sudoku_result(nsolution, solutions, param->results);
     }
 
-    return 1;
+    ++param->nfound;
+
+    return param->nfound >= param->limit ? 1 : 0;
 }
 
 //! @brief 数独用にDLXの全要素を配置する
@@ -129,29 +164,46 @@ static void set_dlx_sudoku_problem(dlx_t *dlx, const char *problem)
     }
 }
 
-int solve_dlx_sudoku(const char *problem, char *result)
+//! @brief  数独の問題を設定したDLXで解を探す
+//! @param  problem         数独の問題
+//! @param  result          数独の解 (空白で初期化する)
+//! @param  solved_cb       解が得られたときに呼ぶコールバック関数
+//! @param  solved_cb_param コールバック関数の引数
+//! @retval -1              DLX構造体を確保できなかった
+//! @retval 0               コールバック関数が探索を打ち切らなかった
+//! @retval 1               コールバック関数が探索を打ち切った
+static int run_dlx_sudoku(const char *problem, char *result, dlx_solved_cb_t solved_cb, void *solved_cb_param)
 {
-    dlx_t *dlx = dlx_new(N * N_ROW * N_COL, N_ROW * N_COL * N_TYPE_COL, solve_dlx_sudoku_cb, result);
+    dlx_t *dlx = dlx_new(N * N_ROW * N_COL, N_ROW * N_COL * N_TYPE_COL, solved_cb, solved_cb_param);
 
-    if(dlx == NULL) return 0;
+    if(dlx == NULL) return -1;
 
     memset(result, '.', N_CELL);
 
     result[N_CELL] = '\0';
 
-    int solved_ploblem = 0;
-
     dlx_set_all_cell(dlx);
     set_dlx_sudoku_problem(dlx, problem);
 
-    if(dlx_solve(dlx))
-    {
-        solved_ploblem = 1;
-    }
+    const int stopped = dlx_solve(dlx);
 
     dlx_delete(dlx);
 
-    return solved_ploblem;
+    return stopped;
+}
+
+int solve_dlx_sudoku(const char *problem, char *result)
+{
+    return run_dlx_sudoku(problem, result, solve_dlx_sudoku_cb, result) == 1 ? 1 : 0;
+}
+
+int count_dlx_sudoku(const char *problem, char *result, const int limit)
+{
+    count_dlx_sudoku_param_t param = {result, 0, limit};
+
+    if(run_dlx_sudoku(problem, result, count_dlx_sudoku_cb, &param) < 0) return 0;
+
+    return param.nfound;
 }
 
 #ifdef DLX_SUDOKU_MAIN
@@ -9,71 +9,268 @@
 
 #include <opencv2/highgui.hpp>
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
 #include "debuglog.h"
+#include "FrameRecorder.h"
+#include "SudokuFrontend.h"
+#include "SudokuPipeline.h"
 #include "VideoSudoku.h"
 
 namespace
 {
 using namespace cv;
+using namespace std;
 using namespace videosudoku;
 
 constexpr auto result_size = 400; //!< 結果画像のサイズ
-constexpr auto camera_id = 0;     //!< カメラデバイスのID
-constexpr auto wait_time = 16;    //!< キー入力の待ち時間 (ms)
+constexpr auto default_source = "camera:0"; //!< 既定の入力 (カメラデバイスのID 0)
+constexpr auto wait_time = 5;     //!< キー入力の待ち時間 (ms 表示段がキューを確認する間隔)
 constexpr auto code_escape = 27;  //!< Escapeキーのキーコード
 constexpr auto code_space = 32;   //!< Spaceキーのキーコード
 
-//! @brief  VideoSudokuのインスタンスを初期化する
+//! @brief  VideoSudokuのインスタンスを初期化して入力を開く
 //! @param  videosudoku 初期化するインスタンス
+//! @param  frontend    入力を開くインスタンス
+//! @param  source      入力の場所 (frameSourceFactory に渡す文字列)
+//! @param  ocr_name    文字認識オブジェクトの種類 (nullptr の場合は既定の種類)
+//! @param  model_file  モデルデータのパス (nullptr の場合は既定のモデル)
 //! @retval true  成功した場合
 //! @retval false 失敗した場合
-bool initialize(VideoSudoku &videoSudoku)
+bool initialize(VideoSudoku &videoSudoku, SudokuFrontend &frontend, const char *source, const char *ocr_name, const char *model_file)
 {
-    const auto code = videoSudoku.initialize(result_size, camera_id);
+    if(videoSudoku.initialize(result_size, ocr_name, model_file) != 0)
+    {
+        ERROR("The OCR initialization was failed. : %s", ocr_name ? ocr_name : "(default)");
 
-    if(code != 0)
+        return false;
+    }
+
+    // モデルデータの読み込みは入力を開く処理と並行して行われる。
+    if(!frontend.open(source))
     {
-        if(code == 1)
-        {
-            ERROR("The camera device wasn't able to be opened.");
-        }
-        else if(code == 2)
-        {
-            ERROR("The OCR initialization was failed.");
-        }
-        else if(code == 3)
-        {
-            ERROR("The model file wasn't able to be opened.");
-        }
+        ERROR("The input source wasn't able to be opened. : %s", source);
 
         return false;
     }
 
     return true;
 }
+
+//! @brief 一定時間ごとに処理時間の統計を標準エラー出力に書き出す
+//! @param videoSudoku    統計を記録しているインスタンス
+//! @param stats_interval 書き出す間隔 (秒 0 以下の場合は書き出さない)
+//! @param last_dump      前回書き出した時刻 (書き出した場合は更新する)
+void dump_statistics(const VideoSudoku &videoSudoku, const double stats_interval, chrono::steady_clock::time_point &last_dump)
+{
+    if(stats_interval <= 0) return;
+
+    const auto now = chrono::steady_clock::now();
+
+    if(chrono::duration<double>(now - last_dump).count() < stats_interval) return;
+
+    videoSudoku.get_statistics().dump(stderr);
+    last_dump = now;
+}
+
+//! @brief  画面表示を行わずに入力画像を処理し、画像ごとの処理結果を書き出す
+//! @param  videoSudoku    初期化済みのインスタンス
+//! @param  frontend       入力を開いたインスタンス
+//! @param  output_file    出力ファイルのパス (nullptr の場合は標準出力)
+//! @param  max_frames     処理する画像の数の上限 (0 以下の場合は入力が終わるまで)
+//! @param  stats_interval 処理時間の統計を書き出す間隔 (秒 0 以下の場合は書き出さない)
+//! @return 終了コード
+int run_headless(VideoSudoku &videoSudoku, SudokuFrontend &frontend, const char *output_file, const long max_frames, const double stats_interval)
+{
+    FrameRecorder recorder;
+
+    if(!recorder.open(output_file))
+    {
+        ERROR("The output file wasn't able to be opened. : %s", output_file);
+
+        return 1;
+    }
+
+    // 全ての画像の結果を残すため、画面表示のモードとは異なりモデルデータの読み込みを待ってから始める。
+    if(videoSudoku.wait_ocr() != 0)
+    {
+        ERROR("The model file wasn't able to be opened.");
+
+        return 1;
+    }
+
+    Mat frame;
+
+    const auto start = chrono::steady_clock::now();
+
+    auto last_dump = start;
+
+    for(auto frame_index = 0L; max_frames <= 0 || frame_index < max_frames; ++frame_index)
+    {
+        if(!frontend.capture_video(frame)) break;
+
+        const auto timestamp_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        videoSudoku.solve(frame);
+
+        recorder.write(frame_index, timestamp_ms, videoSudoku);
+
+        dump_statistics(videoSudoku, stats_interval, last_dump);
+    }
+
+    // 最後の間隔の分も残すため、終了時にも書き出す。
+    if(stats_interval > 0)
+    {
+        videoSudoku.get_statistics().dump(stderr);
+    }
+
+    return 0;
+}
 }
 
 #ifdef APP_MAIN
-int main()
+int main(int argc, char *argv[])
 {
+    // 引数で文字認識オブジェクトの種類とモデルデータを選べる。
+    // -headless を指定すると画面表示を行わず、画像ごとの処理結果を NDJSON で書き出す。
+    // -source でカメラ以外の入力 (動画ファイル、画像の連番、標準入力) を選べる。
+    // -overlay を指定すると、解いた数字を入力画像の数独の上に重ねて表示する。
+    // -log-level で出力するログのレベルを選べる。
+    // -stats を指定すると、段階ごとの処理時間の百分位数と結果の回数を指定した秒数ごとに標準エラー出力に書き出す。
+    const char *source = default_source;
+    const char *pacing_name = nullptr;
+    const char *ocr_name = nullptr;
+    const char *model_file = nullptr;
+    const char *output_file = nullptr;
+
+    auto headless = false;
+    auto overlay = false;
+    auto max_frames = 0L;
+    auto frame_rate = 0.0;
+    auto stats_interval = 0.0;
+    auto gate_threshold = DEFAULT_GATE_THRESHOLD;
+    auto gate_refresh = DEFAULT_GATE_REFRESH;
+    auto positional = 0;
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-headless") == 0)
+        {
+            headless = true;
+        }
+        else if(strcmp(argv[i], "-output") == 0 && i + 1 < argc)
+        {
+            output_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+        {
+            max_frames = atol(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-source") == 0 && i + 1 < argc)
+        {
+            source = argv[++i];
+        }
+        else if(strcmp(argv[i], "-pacing") == 0 && i + 1 < argc)
+        {
+            pacing_name = argv[++i];
+        }
+        else if(strcmp(argv[i], "-fps") == 0 && i + 1 < argc)
+        {
+            frame_rate = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-overlay") == 0)
+        {
+            overlay = true;
+        }
+        else if(strcmp(argv[i], "-log-level") == 0 && i + 1 < argc)
+        {
+            auto level = LOG_LEVEL_DEBUG;
+
+            if(!parse_log_level(argv[++i], level))
+            {
+                ERROR("Unknown log level. : %s", argv[i]);
+
+                return 1;
+            }
+
+            set_log_level(level);
+        }
+        else if(strcmp(argv[i], "-stats") == 0 && i + 1 < argc)
+        {
+            stats_interval = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-gate-threshold") == 0 && i + 1 < argc)
+        {
+            gate_threshold = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-gate-refresh") == 0 && i + 1 < argc)
+        {
+            gate_refresh = atoi(argv[++i]);
+        }
+        else if(positional == 0)
+        {
+            ocr_name = argv[i];
+            ++positional;
+        }
+        else if(positional == 1)
+        {
+            model_file = argv[i];
+            ++positional;
+        }
+        else
+        {
+            ERROR("Usage: %s [-source location] [-pacing fast|realtime] [-fps n] [-gate-threshold x] [-gate-refresh n] [-overlay] [-stats seconds] [-log-level none|error|log|debug] [-headless] [-output file] [-frames n] [ocr_name [model_file]]", argv[0]);
+
+            return 1;
+        }
+    }
+
     VideoSudoku videoSudoku;
+    SudokuFrontend frontend(videoSudoku);
 
-    if(!initialize(videoSudoku)) return 1;
+    if(!initialize(videoSudoku, frontend, source, ocr_name, model_file)) return 1;
+
+    // 既定では、画面表示のモードは録画した映像も実時間で再生し、ヘッドレスモードは待たずに処理する。
+    auto realtime = !headless;
+
+    if(pacing_name)
+    {
+        realtime = strcmp(pacing_name, "realtime") == 0;
+    }
+
+    frontend.set_pacing(realtime ? PACING_REALTIME : PACING_FAST, frame_rate);
+    videoSudoku.set_gating(gate_threshold, gate_refresh);
+    videoSudoku.set_overlay(overlay);
+
+    if(headless) return run_headless(videoSudoku, frontend, output_file, max_frames, stats_interval);
+
+    // 入力と処理は別スレッドで動かし、メインスレッドは表示とキー入力だけを行う。
+    SudokuPipeline pipeline(videoSudoku, frontend);
+
+    pipeline.start();
 
     auto continuation = true;
     auto state_holding = false;
+    auto last_dump = chrono::steady_clock::now();
 
     while(continuation)
     {
-        if(!state_holding)
+        // モデルデータはバックグラウンドで読み込まれるため、失敗はループの中で検出する。
+        if(pipeline.ocr_status() == 3)
         {
-            if(!videoSudoku.capture_video())
-            {
-                continuation = false;
-            }
+            ERROR("The model file wasn't able to be opened.");
+
+            pipeline.stop();
+
+            return 1;
         }
 
-        videoSudoku.display(videoSudoku.solve());
+        if(!pipeline.display())
+        {
+            continuation = false;
+        }
 
         // 環境によって取得されるキーコードが変わるため、256との剰余を取る。
         const auto key = waitKey(wait_time) % 256;
@@ -85,7 +282,18 @@ int main()
         else if(key == code_space)
         {
             state_holding = !state_holding;
+
+            pipeline.set_holding(state_holding);
         }
+
+        dump_statistics(videoSudoku, stats_interval, last_dump);
+    }
+
+    pipeline.stop();
+
+    if(stats_interval > 0)
+    {
+        videoSudoku.get_statistics().dump(stderr);
     }
 
     return 0;
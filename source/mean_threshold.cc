@@ -0,0 +1,153 @@
+//!
+//! @file  mean_threshold.cc
+//! @brief mean_threshold モジュール実装
+//!
+
+#include "mean_threshold.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+using namespace cv;
+using namespace std;
+}
+
+namespace videosudoku
+{
+bool MeanThreshold::apply(const Mat &src, Mat &dst, const int max_value, const int threshold_type, const int block_size, const double delta)
+{
+    if(src.type() != CV_8UC1 || src.empty() || block_size % 2 != 1 || block_size < 3) return false;
+
+    dst.create(src.size(), CV_8UC1);
+
+    const auto radius = block_size / 2;
+    const auto area = block_size * block_size;
+    const auto inverse = threshold_type == THRESH_BINARY_INV;
+    const auto value = static_cast<unsigned char>(saturate_cast<uchar>(max_value));
+
+    integrate(src, radius);
+
+    // adaptiveThreshold は平均を四捨五入した整数 mean = floor((2 * sum + area) / (2 * area)) と比べる。
+    // THRESH_BINARY は src + idelta > mean、THRESH_BINARY_INV は src + idelta <= mean で値を立てる (idelta は delta を切り上げ/切り捨てた整数)。
+    // area が奇数のため、mean <= src + idelta - 1 は sum <= area * (src + idelta - 1) + (area - 1) / 2 と同値になり、除算を省ける。
+    const auto idelta = inverse ? static_cast<int>(floor(delta)) : static_cast<int>(ceil(delta));
+    const auto offset = area * (idelta - 1) + (area - 1) / 2;
+
+#ifdef __SSE2__
+    const auto zero = _mm_setzero_si128();
+    const auto area_lanes = _mm_set1_epi32(area);
+    const auto offset_lanes = _mm_set1_epi32(offset);
+    const auto value_lanes = _mm_set1_epi8(static_cast<char>(value));
+    const auto invert_lanes = inverse ? zero : _mm_set1_epi8(-1);
+#endif
+
+    for(auto y = 0; y < src.rows; ++y)
+    {
+        const auto source = src.ptr<unsigned char>(y);
+        const auto target = dst.ptr<unsigned char>(y);
+
+        // ブロックの上端と下端の積分画像の行 (積分画像は端を radius だけ複製した画像のもの)
+        const auto top = &integral[static_cast<size_t>(y) * static_cast<size_t>(integral_step)];
+        const auto bottom = top + static_cast<size_t>(block_size) * static_cast<size_t>(integral_step);
+
+        auto x = 0;
+
+#ifdef __SSE2__
+        for(; x + 16 <= src.cols; x += 16)
+        {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + x));
+            const __m128i halves[2] = {_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero)};
+
+            __m128i masks[4];
+
+            for(auto i = 0; i < 4; ++i)
+            {
+                const auto column = x + i * 4;
+
+                const auto sum = _mm_add_epi32(
+                    _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bottom + column + block_size)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(bottom + column))),
+                    _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(top + column)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(top + column + block_size))));
+
+                // 画素値を32bitに広げて area 倍する (SSE2 には32bitの乗算が無いため、上位を 0 にした16bitの積和で求める)。
+                const auto half = halves[i / 2];
+                const auto wide = i % 2 == 0 ? _mm_unpacklo_epi16(half, zero) : _mm_unpackhi_epi16(half, zero);
+                const auto bound = _mm_add_epi32(_mm_madd_epi16(wide, area_lanes), offset_lanes);
+
+                masks[i] = _mm_cmpgt_epi32(sum, bound);
+            }
+
+            // sum > bound を 8bit に詰め、THRESH_BINARY の場合は反転する。
+            const auto packed = _mm_packs_epi16(_mm_packs_epi32(masks[0], masks[1]), _mm_packs_epi32(masks[2], masks[3]));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), _mm_and_si128(_mm_xor_si128(packed, invert_lanes), value_lanes));
+        }
+#endif
+
+        for(; x < src.cols; ++x)
+        {
+            const auto sum = static_cast<int>(bottom[x + block_size] - bottom[x] - top[x + block_size] + top[x]);
+            const auto above = sum > area * source[x] + offset;
+
+            target[x] = above == inverse ? value : 0;
+        }
+    }
+
+    return true;
+}
+
+void MeanThreshold::integrate(const Mat &src, const int radius)
+{
+    const auto padded_cols = src.cols + 2 * radius;
+    const auto padded_rows = src.rows + 2 * radius;
+
+    integral_step = padded_cols + 1;
+
+    // 画像のサイズが変わっても縮めずに、大きい方の領域を使い回す。
+    const auto required = static_cast<size_t>(integral_step) * static_cast<size_t>(padded_rows + 1);
+
+    if(integral.size() < required)
+    {
+        integral.resize(required);
+    }
+
+    fill(integral.begin(), integral.begin() + integral_step, 0);
+
+    for(auto row = 0; row < padded_rows; ++row)
+    {
+        const auto source = src.ptr<unsigned char>(min(max(row - radius, 0), src.rows - 1));
+        const auto previous = &integral[static_cast<size_t>(row) * static_cast<size_t>(integral_step)];
+        const auto current = previous + integral_step;
+
+        auto sum = 0u;
+
+        current[0] = 0;
+
+        // 左右の端は端の画素を複製する。
+        for(auto col = 0; col < radius; ++col)
+        {
+            sum += source[0];
+            current[col + 1] = previous[col + 1] + sum;
+        }
+
+        for(auto col = 0; col < src.cols; ++col)
+        {
+            sum += source[col];
+            current[col + radius + 1] = previous[col + radius + 1] + sum;
+        }
+
+        for(auto col = src.cols + radius; col < padded_cols; ++col)
+        {
+            sum += source[src.cols - 1];
+            current[col + 1] = previous[col + 1] + sum;
+        }
+    }
+}
+}
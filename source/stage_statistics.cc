@@ -0,0 +1,176 @@
+//!
+//! @file  stage_statistics.cc
+//! @brief 処理の段階と結果の名前、StageStatistics クラス実装
+//!
+
+#include "stage_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+//! @brief  昇順に並べた計測から百分位数を求める (最近順位法)
+//! @param  sorted  昇順に並べた計測
+//! @param  percent 百分位 (0-100)
+//! @return 百分位数
+double nearest_rank(const vector<double> &sorted, const double percent)
+{
+    const auto rank = static_cast<size_t>(ceil(percent / 100 * static_cast<double>(sorted.size())));
+
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+}
+
+namespace videosudoku
+{
+const char *sudokuStageName(const SudokuStage stage)
+{
+    static const char *const names[STAGE_NUMBER] = {"capture", "binarization", "contour", "warp", "delete_grid", "ocr", "solve", "display"};
+
+    return stage >= 0 && stage < STAGE_NUMBER ? names[stage] : "unknown";
+}
+
+const char *sudokuOutcomeName(const SudokuOutcome outcome)
+{
+    static const char *const names[OUTCOME_NUMBER] = {"not_ready", "no_contour", "rejected", "few_givens", "unsolvable", "solved"};
+
+    return outcome >= 0 && outcome < OUTCOME_NUMBER ? names[outcome] : "unknown";
+}
+
+StageStatistics::StageStatistics(const int window): window_size(static_cast<size_t>(max(window, 1)))
+{
+    // 記録のたびに領域を確保しないように、最初に確保しておく。
+    for(auto &stage_samples: samples)
+    {
+        stage_samples.reserve(window_size);
+    }
+
+    sorted_samples.reserve(window_size);
+
+    reset();
+}
+
+void StageStatistics::record(const SudokuStage stage, const double time_us)
+{
+    if(stage < 0 || stage >= STAGE_NUMBER) return;
+
+    lock_guard<mutex> guard(lock);
+
+    auto &stage_samples = samples[stage];
+
+    if(stage_samples.size() < window_size)
+    {
+        stage_samples.push_back(time_us);
+    }
+    else
+    {
+        stage_samples[next_sample[stage]] = time_us;
+    }
+
+    next_sample[stage] = (next_sample[stage] + 1) % window_size;
+}
+
+void StageStatistics::count(const SudokuOutcome outcome, const bool reused)
+{
+    if(outcome < 0 || outcome >= OUTCOME_NUMBER) return;
+
+    lock_guard<mutex> guard(lock);
+
+    ++outcome_counts[outcome];
+
+    if(reused)
+    {
+        ++reused_count;
+    }
+}
+
+StagePercentiles StageStatistics::get_percentiles(const SudokuStage stage) const
+{
+    if(stage < 0 || stage >= STAGE_NUMBER) return {};
+
+    lock_guard<mutex> guard(lock);
+
+    return percentiles(stage);
+}
+
+long StageStatistics::get_outcome_count(const SudokuOutcome outcome) const
+{
+    if(outcome < 0 || outcome >= OUTCOME_NUMBER) return 0;
+
+    lock_guard<mutex> guard(lock);
+
+    return outcome_counts[outcome];
+}
+
+long StageStatistics::get_reused_count() const
+{
+    lock_guard<mutex> guard(lock);
+
+    return reused_count;
+}
+
+void StageStatistics::dump(FILE *output) const
+{
+    if(!output) return;
+
+    lock_guard<mutex> guard(lock);
+
+    fprintf(output, "[STATS] %-12s %10s %10s %10s %8s\n", "stage", "p50(us)", "p95(us)", "p99(us)", "samples");
+
+    for(auto i = 0; i < STAGE_NUMBER; ++i)
+    {
+        const auto stage = static_cast<SudokuStage>(i);
+        const auto result = percentiles(stage);
+
+        fprintf(output, "[STATS] %-12s %10.1f %10.1f %10.1f %8ld\n", sudokuStageName(stage), result.p50, result.p95, result.p99, result.samples);
+    }
+
+    fputs("[STATS] outcomes", output);
+
+    for(auto i = 0; i < OUTCOME_NUMBER; ++i)
+    {
+        fprintf(output, " %s=%ld", sudokuOutcomeName(static_cast<SudokuOutcome>(i)), outcome_counts[i]);
+    }
+
+    fprintf(output, " reused=%ld\n", reused_count);
+    fflush(output);
+}
+
+void StageStatistics::reset()
+{
+    lock_guard<mutex> guard(lock);
+
+    for(auto i = 0; i < STAGE_NUMBER; ++i)
+    {
+        samples[i].clear();
+        next_sample[i] = 0;
+    }
+
+    fill(outcome_counts, outcome_counts + OUTCOME_NUMBER, 0L);
+    reused_count = 0;
+}
+
+StagePercentiles StageStatistics::percentiles(const SudokuStage stage) const
+{
+    StagePercentiles result;
+
+    const auto &stage_samples = samples[stage];
+
+    if(stage_samples.empty()) return result;
+
+    // 直近の計測は数百個程度のため、要求のたびに並べ替えても十分に速い。
+    sorted_samples.assign(stage_samples.begin(), stage_samples.end());
+    sort(sorted_samples.begin(), sorted_samples.end());
+
+    result.p50 = nearest_rank(sorted_samples, 50);
+    result.p95 = nearest_rank(sorted_samples, 95);
+    result.p99 = nearest_rank(sorted_samples, 99);
+    result.samples = static_cast<long>(sorted_samples.size());
+
+    return result;
+}
+}
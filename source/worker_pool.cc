@@ -0,0 +1,111 @@
+//!
+//! @file  worker_pool.cc
+//! @brief WorkerPool クラス実装
+//!
+
+#include "worker_pool.h"
+
+namespace
+{
+using namespace std;
+}
+
+namespace videosudoku
+{
+WorkerPool::WorkerPool(const int threads)
+{
+    for(auto i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for(auto &worker: workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(const int count, const function<void(int)> &work)
+{
+    if(count <= 0) return;
+
+    // 処理が1つだけ又はスレッドが無い場合は、スレッドを起こさずに呼び出し元で実行する。
+    if(count == 1 || workers.empty())
+    {
+        for(auto i = 0; i < count; ++i)
+        {
+            work(i);
+        }
+
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+
+        task = &work;
+        task_count = count;
+        next_task = 0;
+        idle_workers = 0;
+        ++generation;
+    }
+
+    wake.notify_all();
+
+    drain();
+
+    // 他のスレッドが実行中の処理が終わるまで待つ。
+    unique_lock<mutex> guard(lock);
+
+    finished.wait(guard, [this] { return idle_workers == static_cast<int>(workers.size()); });
+
+    task = nullptr;
+}
+
+void WorkerPool::worker_loop()
+{
+    auto seen = 0L;
+
+    for(;;)
+    {
+        {
+            unique_lock<mutex> guard(lock);
+
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+
+            if(stopping) return;
+
+            seen = generation;
+        }
+
+        drain();
+
+        {
+            lock_guard<mutex> guard(lock);
+
+            ++idle_workers;
+        }
+
+        finished.notify_one();
+    }
+}
+
+void WorkerPool::drain()
+{
+    for(auto index = next_task++; index < task_count; index = next_task++)
+    {
+        (*task)(index);
+    }
+}
+}
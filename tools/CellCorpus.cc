@@ -0,0 +1,138 @@
+//!
+//! @file  CellCorpus.cc
+//! @brief CellCorpus クラス実装
+//!
+
+#include "CellCorpus.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+using namespace cv;
+using namespace std;
+
+constexpr char packed_magic[8] = {'V', 'S', 'C', 'E', 'L', 'L', 'S', '1'}; //!< パック形式の識別子
+
+constexpr auto nr_label = 10; //!< ラベルの種類 (0 と 1-9)
+}
+
+namespace videosudoku
+{
+bool CellCorpus::load(const char *path)
+{
+    cells.clear();
+
+    struct stat st;
+
+    if(stat(path, &st) != 0) return false;
+
+    return S_ISDIR(st.st_mode) ? load_directory(path) : load_packed(path);
+}
+
+bool CellCorpus::save(const char *file_name) const
+{
+    if(cells.empty()) return false;
+
+    const auto size = cells.front().image.size();
+
+    auto fp = fopen(file_name, "wb");
+
+    if(!fp) return false;
+
+    const uint32_t header[3] = {static_cast<uint32_t>(cells.size()), static_cast<uint32_t>(size.height), static_cast<uint32_t>(size.width)};
+
+    auto result = fwrite(packed_magic, sizeof(packed_magic), 1, fp) == 1 && fwrite(header, sizeof(header), 1, fp) == 1;
+
+    Mat resized;
+
+    for(const auto &cell: cells)
+    {
+        if(!result) break;
+
+        const auto label = static_cast<uint8_t>(cell.label);
+
+        resize(cell.image, resized, size, 0, 0, INTER_AREA);
+
+        result = fwrite(&label, 1, 1, fp) == 1;
+
+        for(auto row = 0; result && row < resized.rows; ++row)
+        {
+            result = fwrite(resized.ptr<unsigned char>(row), 1, static_cast<size_t>(resized.cols), fp) == static_cast<size_t>(resized.cols);
+        }
+    }
+
+    return (fclose(fp) == 0) && result;
+}
+
+bool CellCorpus::load_directory(const char *root)
+{
+    vector<String> files;
+
+    for(auto label = 0; label < nr_label; ++label)
+    {
+        glob(string(root) + "/" + to_string(label) + "/*.png", files, false);
+
+        for(const auto &file: files)
+        {
+            auto image = imread(file, IMREAD_GRAYSCALE);
+
+            if(image.empty()) continue;
+
+            cells.push_back({label, image});
+        }
+    }
+
+    return !cells.empty();
+}
+
+bool CellCorpus::load_packed(const char *file_name)
+{
+    auto fp = fopen(file_name, "rb");
+
+    if(!fp) return false;
+
+    char magic[sizeof(packed_magic)];
+    uint32_t header[3];
+
+    auto result = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, packed_magic, sizeof(magic)) == 0 && fread(header, sizeof(header), 1, fp) == 1;
+
+    const auto count = result ? header[0] : 0;
+    const auto rows = result ? static_cast<int>(header[1]) : 0;
+    const auto cols = result ? static_cast<int>(header[2]) : 0;
+
+    cells.reserve(count);
+
+    for(auto i = 0u; result && i < count; ++i)
+    {
+        uint8_t label = 0;
+        Mat image(rows, cols, CV_8UC1);
+
+        result = fread(&label, 1, 1, fp) == 1 && label < nr_label;
+
+        for(auto row = 0; result && row < rows; ++row)
+        {
+            result = fread(image.ptr<unsigned char>(row), 1, static_cast<size_t>(cols), fp) == static_cast<size_t>(cols);
+        }
+
+        if(result)
+        {
+            cells.push_back({label, image});
+        }
+    }
+
+    fclose(fp);
+
+    if(!result) cells.clear();
+
+    return result && !cells.empty();
+}
+}
@@ -0,0 +1,59 @@
+//!
+//! @file  CellCorpus.h
+//! @brief CellCorpus クラス定義 (ラベル付きのマス画像の集合)
+//!
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace videosudoku
+{
+//! @brief ラベル付きのマス画像
+struct LabeledCell
+{
+    int label;       //!< 正解の数字 (0 は空白)
+    cv::Mat image;   //!< マス画像 (グレースケール VideoSudoku が切り出す二値画像と同じ形式)
+};
+
+//! @brief ラベル付きのマス画像の集合を読み書きするクラス
+//!
+//! 次の2つの形式を読み込める。
+//! - ディレクトリ: <root>/<0-9>/*.png (ディレクトリ名が正解の数字 0 は空白)
+//! - パック形式: "VSCELLS1" に続いて件数, ROW, COL (uint32_t) と、件数分の ラベル (uint8_t) + 画素 (ROW * COL バイト)
+class CellCorpus final
+{
+public:
+    //! @brief  ディレクトリまたはパック形式のファイルを読み込む
+    //! @param  path  ディレクトリまたはファイルのパス
+    //! @retval true  成功
+    //! @retval false 失敗
+    bool load(const char *path);
+
+    //! @brief  パック形式で書き出す (すべての画像を最初の画像のサイズに揃える)
+    //! @param  file_name 出力ファイル
+    //! @retval true      成功
+    //! @retval false     失敗
+    bool save(const char *file_name) const;
+
+    //! @brief 読み込んだマス画像
+    const std::vector<LabeledCell> &get_cells() const { return cells; }
+
+private:
+    //! @brief  ディレクトリから読み込む
+    //! @param  root  ルートディレクトリ
+    //! @retval true  1枚以上読み込めた
+    //! @retval false 読み込めなかった
+    bool load_directory(const char *root);
+
+    //! @brief  パック形式のファイルから読み込む
+    //! @param  file_name ファイルのパス
+    //! @retval true      成功
+    //! @retval false     失敗
+    bool load_packed(const char *file_name);
+
+    std::vector<LabeledCell> cells; //!< マス画像
+};
+}
@@ -0,0 +1,128 @@
+//!
+//! @file  convert_model.cc
+//! @brief libsvm のテキスト形式のモデルをバイナリモデルに変換するツール
+//!
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <svm.h>
+
+#include "debuglog.h"
+#include "SVMModel.h"
+#include "SVMOCR.h"
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto max_decision_error = 1e-3; //!< 変換前後の決定値の誤差の許容値
+
+//! @brief  変換したモデルが libsvm と同じ結果を返すか、サポートベクタ自身を入力として確かめる
+//! @param  text_model   変換元のモデル
+//! @param  binary_model 変換したモデル
+//! @retval true         一致した
+//! @retval false        一致しなかった
+bool verify(const svm_model *text_model, const SVMModel &binary_model)
+{
+    const auto nr_class = binary_model.get_nr_class();
+    const auto nr_pair = static_cast<size_t>(nr_class * (nr_class - 1) / 2);
+
+    vector<float> x(static_cast<size_t>(binary_model.get_stride()));
+    vector<double> kvalue(static_cast<size_t>(binary_model.get_total_sv()));
+    vector<double> expected(nr_pair);
+    vector<double> actual(nr_pair);
+
+    for(auto i = 0; i < text_model->l; ++i)
+    {
+        fill(x.begin(), x.end(), 0.0f);
+
+        for(auto node = text_model->SV[i]; node->index != -1; ++node)
+        {
+            x[static_cast<size_t>(node->index - 1)] = static_cast<float>(node->value);
+        }
+
+        const auto expected_label = static_cast<int>(svm_predict_values(text_model, text_model->SV[i], expected.data()));
+        const auto actual_label = binary_model.predict_values(x.data(), kvalue.data(), actual.data());
+
+        if(expected_label != actual_label)
+        {
+            ERROR("label mismatch at SV %d : %d != %d", i, expected_label, actual_label);
+
+            return false;
+        }
+
+        for(auto p = 0u; p < nr_pair; ++p)
+        {
+            if(fabs(expected[p] - actual[p]) > max_decision_error)
+            {
+                ERROR("decision value mismatch at SV %d : %f != %f", i, expected[p], actual[p]);
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        printf("usage: %s <libsvm model> <binary model> [dim=%d]\n", argv[0], DATA_SIZE);
+
+        return 1;
+    }
+
+    const auto dim = argc > 3 ? atoi(argv[3]) : DATA_SIZE;
+
+    auto text_model = svm_load_model(argv[1]);
+
+    if(!text_model)
+    {
+        ERROR("The model file wasn't able to be opened. : %s", argv[1]);
+
+        return 1;
+    }
+
+    SVMModel binary_model;
+
+    if(!binary_model.assign(text_model, dim))
+    {
+        ERROR("The model wasn't able to be converted.");
+
+        svm_free_and_destroy_model(&text_model);
+
+        return 1;
+    }
+
+    if(!binary_model.save(argv[2]))
+    {
+        ERROR("The binary model wasn't able to be written. : %s", argv[2]);
+
+        svm_free_and_destroy_model(&text_model);
+
+        return 1;
+    }
+
+    // 書き出したファイルをマップし直して検証する。
+    const auto verified = binary_model.load(argv[2]) && verify(text_model, binary_model);
+
+    svm_free_and_destroy_model(&text_model);
+
+    if(!verified)
+    {
+        ERROR("The binary model doesn't match the libsvm model.");
+
+        return 1;
+    }
+
+    LOG("%s -> %s (total_sv %d, dim %d)", argv[1], argv[2], binary_model.get_total_sv(), binary_model.get_dim());
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+//!
+//! @file  derive_linear_model.cc
+//! @brief 線形カーネルの SVM モデルから LinearOCR 用の縮小画像の線形モデルを導出するツール
+//!
+//! 線形カーネルの one-vs-one の決定関数はサポートベクタを重みに畳み込むと w・x - rho になる。
+//! 入力画像を factor x factor ブロックの面積平均で縮小したとき、ブロック内の重みの和を新しい重みとすれば、
+//! ブロック内の画素値が一様な場合に元の決定値と一致する。
+//!
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <svm.h>
+
+#include "debuglog.h"
+#include "LinearModel.h"
+#include "SVMOCR.h"
+
+namespace
+{
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto default_image_rc = 15; //!< 縮小画像の ROW, COL サイズの既定値
+
+//! @brief  サポートベクタを密な形式に展開する
+//! @param  node サポートベクタ
+//! @param  x    展開先 (DATA_SIZE 要素)
+void to_dense(const svm_node *node, vector<double> &x)
+{
+    fill(x.begin(), x.end(), 0.0);
+
+    for(; node->index != -1; ++node)
+    {
+        if(node->index >= 1 && node->index <= DATA_SIZE)
+        {
+            x[static_cast<size_t>(node->index - 1)] = node->value;
+        }
+    }
+}
+
+//! @brief 画像をブロックの面積平均で縮小する
+//! @param x        元の画像 (DATA_RC x DATA_RC)
+//! @param image_rc 縮小画像の ROW, COL サイズ
+//! @param small    縮小画像
+void shrink(const vector<double> &x, const int image_rc, vector<float> &small)
+{
+    const auto factor = DATA_RC / image_rc;
+
+    fill(small.begin(), small.end(), 0.0f);
+
+    for(auto row = 0; row < DATA_RC; ++row)
+    {
+        for(auto col = 0; col < DATA_RC; ++col)
+        {
+            const auto index = (row / factor) * image_rc + (col / factor);
+
+            small[static_cast<size_t>(index)] += static_cast<float>(x[static_cast<size_t>(row * DATA_RC + col)] / (factor * factor));
+        }
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        printf("usage: %s <libsvm model (linear kernel)> <linear model> [image_rc=%d]\n", argv[0], default_image_rc);
+
+        return 1;
+    }
+
+    const auto image_rc = argc > 3 ? atoi(argv[3]) : default_image_rc;
+
+    if(image_rc <= 0 || DATA_RC % image_rc != 0)
+    {
+        ERROR("image_rc must divide %d.", DATA_RC);
+
+        return 1;
+    }
+
+    auto svm = svm_load_model(argv[1]);
+
+    if(!svm)
+    {
+        ERROR("The model file wasn't able to be opened. : %s", argv[1]);
+
+        return 1;
+    }
+
+    if(svm->param.kernel_type != LINEAR || svm->nr_class > LINEAR_MAX_CLASS)
+    {
+        ERROR("Only linear kernel models can be derived.");
+
+        svm_free_and_destroy_model(&svm);
+
+        return 1;
+    }
+
+    const auto nr_class = svm->nr_class;
+    const auto nr_pair = nr_class * (nr_class - 1) / 2;
+    const auto factor = DATA_RC / image_rc;
+    const auto small_size = static_cast<size_t>(image_rc * image_rc);
+
+    vector<int> start(static_cast<size_t>(nr_class), 0);
+
+    for(auto i = 1; i < nr_class; ++i)
+    {
+        start[static_cast<size_t>(i)] = start[static_cast<size_t>(i - 1)] + svm->nSV[i - 1];
+    }
+
+    vector<double> weights(static_cast<size_t>(nr_pair) * small_size, 0.0);
+    vector<double> biases(static_cast<size_t>(nr_pair), 0.0);
+    vector<double> sv(static_cast<size_t>(DATA_SIZE));
+
+    // 組 (i, j) の決定関数の重みを、libsvm と同じ順序でサポートベクタから畳み込む。
+    auto p = 0;
+
+    for(auto i = 0; i < nr_class; ++i)
+    {
+        for(auto j = i + 1; j < nr_class; ++j)
+        {
+            auto weight = &weights[static_cast<size_t>(p) * small_size];
+
+            for(const auto c: {i, j})
+            {
+                const auto coef = c == i ? svm->sv_coef[j - 1] : svm->sv_coef[i];
+
+                for(auto k = start[static_cast<size_t>(c)]; k < start[static_cast<size_t>(c)] + svm->nSV[c]; ++k)
+                {
+                    to_dense(svm->SV[k], sv);
+
+                    for(auto row = 0; row < DATA_RC; ++row)
+                    {
+                        for(auto col = 0; col < DATA_RC; ++col)
+                        {
+                            weight[(row / factor) * image_rc + (col / factor)] += coef[k] * sv[static_cast<size_t>(row * DATA_RC + col)];
+                        }
+                    }
+                }
+            }
+
+            biases[static_cast<size_t>(p)] = -svm->rho[p];
+
+            ++p;
+        }
+    }
+
+    LinearModel model;
+
+    if(!model.assign(LINEAR_ONE_VS_ONE, nr_class, svm->label, image_rc, weights.data(), biases.data()) || !model.save(argv[2]) || !model.load(argv[2]))
+    {
+        ERROR("The linear model wasn't able to be written. : %s", argv[2]);
+
+        svm_free_and_destroy_model(&svm);
+
+        return 1;
+    }
+
+    // サポートベクタを縮小した画像で、元の SVM との一致率を確かめる。
+    vector<float> x(static_cast<size_t>(model.get_stride()), 0.0f);
+    vector<float> scores(static_cast<size_t>(model.get_nr_function()));
+
+    auto agreement = 0;
+
+    for(auto k = 0; k < svm->l; ++k)
+    {
+        to_dense(svm->SV[k], sv);
+        shrink(sv, image_rc, x);
+
+        if(model.predict(x.data(), scores.data()) == static_cast<int>(svm_predict(svm, svm->SV[k])))
+        {
+            ++agreement;
+        }
+    }
+
+    LOG("%s -> %s (%dx%d, agreement with SVM on support vectors %d/%d)", argv[1], argv[2], image_rc, image_rc, agreement, svm->l);
+
+    svm_free_and_destroy_model(&svm);
+
+    return 0;
+}
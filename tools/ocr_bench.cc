@@ -0,0 +1,227 @@
+//!
+//! @file  ocr_bench.cc
+//! @brief 文字認識の精度と速度を計測するベンチマーク
+//!
+//! ラベル付きのマス画像を任意の SudokuOCR で認識し、1秒あたりの認識数、クラスごとの混同行列、
+//! 1マスあたりの認識時間の p50/p99 を表示する。速度の改善は必ず精度と合わせて確認する。
+//!
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "CellCorpus.h"
+#include "debuglog.h"
+#include "SudokuOCR.h"
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto nr_label = 10; //!< ラベルの種類 (0 と 1-9)
+
+//! @brief 使い方を表示する
+//! @param program プログラム名
+void usage(const char *program)
+{
+    printf("usage: %s [-ocr name] [-model file] [-repeat n] [-pack file] <corpus directory | packed file>\n", program);
+    printf("  -ocr    : SudokuOCR backend (");
+
+    for(const auto &name: sudokuOCRNames())
+    {
+        printf(" %s", name.c_str());
+    }
+
+    printf(" )\n");
+    printf("  -model  : model file (default: backend default)\n");
+    printf("  -repeat : number of passes over the corpus (default: 1)\n");
+    printf("  -pack   : write the corpus in the packed format and exit\n");
+}
+
+//! @brief  昇順に並べた値から百分位を求める
+//! @param  sorted  昇順に並べた値
+//! @param  percent 百分位 (0-100)
+//! @return 百分位の値
+double percentile(const vector<double> &sorted, const double percent)
+{
+    if(sorted.empty()) return 0;
+
+    const auto index = static_cast<size_t>(percent / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+
+    return sorted[min(index, sorted.size() - 1)];
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const char *ocr_name = nullptr;
+    const char *model_file = nullptr;
+    const char *pack_file = nullptr;
+    const char *corpus_path = nullptr;
+
+    auto repeat = 1;
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-ocr") == 0 && i + 1 < argc)
+        {
+            ocr_name = argv[++i];
+        }
+        else if(strcmp(argv[i], "-model") == 0 && i + 1 < argc)
+        {
+            model_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-repeat") == 0 && i + 1 < argc)
+        {
+            repeat = max(1, atoi(argv[++i]));
+        }
+        else if(strcmp(argv[i], "-pack") == 0 && i + 1 < argc)
+        {
+            pack_file = argv[++i];
+        }
+        else
+        {
+            corpus_path = argv[i];
+        }
+    }
+
+    if(!corpus_path)
+    {
+        usage(argv[0]);
+
+        return 1;
+    }
+
+    CellCorpus corpus;
+
+    if(!corpus.load(corpus_path))
+    {
+        ERROR("The corpus wasn't able to be loaded. : %s", corpus_path);
+
+        return 1;
+    }
+
+    const auto &cells = corpus.get_cells();
+
+    if(pack_file)
+    {
+        if(!corpus.save(pack_file))
+        {
+            ERROR("The packed corpus wasn't able to be written. : %s", pack_file);
+
+            return 1;
+        }
+
+        LOG("%zu cells -> %s", cells.size(), pack_file);
+
+        return 0;
+    }
+
+    auto ocr = sudokuOCRFactory(ocr_name);
+
+    if(!ocr)
+    {
+        ERROR("Unknown OCR backend. : %s", ocr_name);
+
+        return 1;
+    }
+
+    if(!ocr->initialize(model_file))
+    {
+        ERROR("The model file wasn't able to be opened.");
+
+        delete ocr;
+
+        return 1;
+    }
+
+    // 最初の1枚はキャッシュやページの読み込みを含むため、計測から外す。
+    {
+        auto warmup = cells.front().image;
+
+        ocr->recognize_number(warmup);
+    }
+
+    int confusion[nr_label][nr_label] = {{0}};
+
+    vector<double> latencies;
+
+    latencies.reserve(cells.size() * static_cast<size_t>(repeat));
+
+    Mat cell;
+
+    const auto begin = chrono::steady_clock::now();
+
+    for(auto pass = 0; pass < repeat; ++pass)
+    {
+        for(const auto &labeled: cells)
+        {
+            // recognize_number は引数の行列ヘッダを書き換えるため、毎回ヘッダを作り直す。
+            cell = labeled.image;
+
+            const auto start = chrono::steady_clock::now();
+            const auto number = ocr->recognize_number(cell);
+            const auto end = chrono::steady_clock::now();
+
+            latencies.push_back(chrono::duration<double, micro>(end - start).count());
+
+            if(number >= 0 && number < nr_label)
+            {
+                ++confusion[labeled.label][number];
+            }
+        }
+    }
+
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    ocr->finalize();
+    delete ocr;
+
+    sort(latencies.begin(), latencies.end());
+
+    const auto total = latencies.size();
+
+    auto correct = 0;
+
+    for(auto i = 0; i < nr_label; ++i)
+    {
+        correct += confusion[i][i];
+    }
+
+    printf("backend     : %s\n", ocr_name ? ocr_name : "(default)");
+    printf("cells       : %zu x %d\n", cells.size(), repeat);
+    printf("accuracy    : %.4f (%d / %zu)\n", static_cast<double>(correct) / static_cast<double>(total), correct, total);
+    printf("throughput  : %.1f cells/s\n", static_cast<double>(total) / elapsed);
+    printf("latency p50 : %.1f us\n", percentile(latencies, 50));
+    printf("latency p99 : %.1f us\n", percentile(latencies, 99));
+    printf("\nconfusion matrix (row: truth, column: predicted, 0: blank)\n     ");
+
+    for(auto j = 0; j < nr_label; ++j)
+    {
+        printf("%6d", j);
+    }
+
+    printf("  recall\n");
+
+    for(auto i = 0; i < nr_label; ++i)
+    {
+        auto row_total = 0;
+
+        printf("%4d ", i);
+
+        for(auto j = 0; j < nr_label; ++j)
+        {
+            printf("%6d", confusion[i][j]);
+
+            row_total += confusion[i][j];
+        }
+
+        printf("  %.4f\n", row_total ? static_cast<double>(confusion[i][i]) / row_total : 0.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+//!
+//! @file  threshold_check.cc
+//! @brief MeanThreshold と adaptiveThreshold の結果を比べる検査
+//!
+//! 乱数、一様、2値の画像について、ブロックの大きさ、定数、二値化の種類、画像の幅を変えて
+//! MeanThreshold::apply と adaptiveThreshold (ADAPTIVE_THRESH_MEAN_C) の結果が全画素で一致するか調べる。
+//! 幅は 16 の倍数でないものも含め、SSE2 でまとめて処理しない行末の画素も確かめる。
+//!
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "debuglog.h"
+#include "mean_threshold.h"
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+const int widths[] = {1, 3, 15, 16, 17, 31, 33, 64, 97, 640, 643}; //!< 画像の幅 (px)
+const int heights[] = {1, 2, 9, 48, 121};                          //!< 画像の高さ (px)
+const int block_sizes[] = {3, 5, 11, 23, 31};                      //!< ブロックの一辺の長さ
+const double deltas[] = {0, 0.5, -0.5, 2, -3, 5.5, -7.25, 40};     //!< 平均から差し引く定数
+const int threshold_types[] = {THRESH_BINARY, THRESH_BINARY_INV};  //!< 二値化の種類
+const int max_values[] = {255, 100};                               //!< 条件を満たす画素の値
+
+//! @brief 検査する画像の種類
+enum ImageKind
+{
+    IMAGE_RANDOM = 0, //!< 一様乱数
+    IMAGE_FLAT,       //!< 全画素が同じ値
+    IMAGE_TWO_LEVEL,  //!< 2つの値の市松模様 (隣り合う値を含む)
+    IMAGE_KIND_NUMBER //!< 画像の種類の数
+};
+
+//! @brief 使い方を表示する
+//! @param program プログラム名
+void usage(const char *program)
+{
+    printf("usage: %s [-seed n] [-repeat n]\n", program);
+    printf("  -seed   : seed of the random images (default: 1)\n");
+    printf("  -repeat : number of random images per size (default: 4)\n");
+}
+
+//! @brief  画像の種類の名前を取得する
+//! @param  kind 画像の種類
+//! @return 名前
+const char *image_kind_name(const int kind)
+{
+    static const char *const names[IMAGE_KIND_NUMBER] = {"random", "flat", "two_level"};
+
+    return names[kind];
+}
+
+//! @brief 検査する画像を作る
+//! @param image   書き出し先 (サイズと型は呼び出し元で決める)
+//! @param kind    画像の種類
+//! @param variant 同じ種類の中の番号 (値の組み合わせを変える)
+//! @param rng     乱数
+void make_image(Mat &image, const int kind, const int variant, RNG &rng)
+{
+    // 隣り合う値は丸めた平均が境界に来るため、比較の丸めの違いが出やすい。
+    static const int levels[][2] = {{0, 255}, {100, 101}, {127, 128}, {254, 255}, {0, 1}};
+
+    constexpr auto levels_number = static_cast<int>(sizeof(levels) / sizeof(levels[0]));
+
+    switch(kind)
+    {
+    case IMAGE_RANDOM:
+        rng.fill(image, RNG::UNIFORM, 0, 256);
+        break;
+    case IMAGE_FLAT:
+        image.setTo(Scalar::all(levels[variant % levels_number][variant / levels_number % 2]));
+        break;
+    default:
+    {
+        const auto &level = levels[variant % levels_number];
+        const auto cell = 1 + variant % 7;
+
+        for(auto y = 0; y < image.rows; ++y)
+        {
+            auto row = image.ptr<unsigned char>(y);
+
+            for(auto x = 0; x < image.cols; ++x)
+            {
+                row[x] = static_cast<unsigned char>(level[(x / cell + y / cell) % 2]);
+            }
+        }
+
+        break;
+    }
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    auto seed = 1;
+    auto repeat = 4;
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+        {
+            seed = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-repeat") == 0 && i + 1 < argc)
+        {
+            repeat = max(1, atoi(argv[++i]));
+        }
+        else
+        {
+            usage(argv[0]);
+
+            return 1;
+        }
+    }
+
+    RNG rng(static_cast<uint64>(seed));
+    MeanThreshold threshold;
+
+    Mat image, expected, actual, difference;
+
+    auto cases = 0L;
+    auto failures = 0L;
+
+    for(const auto width: widths)
+    {
+        for(const auto height: heights)
+        {
+            image.create(height, width, CV_8UC1);
+
+            for(auto kind = 0; kind < IMAGE_KIND_NUMBER; ++kind)
+            {
+                const auto variants = kind == IMAGE_RANDOM ? repeat : 10;
+
+                for(auto variant = 0; variant < variants; ++variant)
+                {
+                    make_image(image, kind, variant, rng);
+
+                    for(const auto block_size: block_sizes)
+                    {
+                        for(const auto delta: deltas)
+                        {
+                            for(const auto threshold_type: threshold_types)
+                            {
+                                for(const auto max_value: max_values)
+                                {
+                                    ++cases;
+
+                                    adaptiveThreshold(image, expected, max_value, ADAPTIVE_THRESH_MEAN_C, threshold_type, block_size, delta);
+
+                                    if(!threshold.apply(image, actual, max_value, threshold_type, block_size, delta))
+                                    {
+                                        ERROR("MeanThreshold rejected the input. : %dx%d block=%d", width, height, block_size);
+
+                                        ++failures;
+
+                                        continue;
+                                    }
+
+                                    compare(expected, actual, difference, CMP_NE);
+
+                                    const auto mismatches = countNonZero(difference);
+
+                                    if(mismatches == 0) continue;
+
+                                    // 最初の不一致の位置を表示して、行末の処理か本体の処理かを見分けられるようにする。
+                                    Point location;
+
+                                    minMaxLoc(difference, nullptr, nullptr, nullptr, &location);
+
+                                    ERROR("Mismatch. : %s #%d %dx%d block=%d delta=%g type=%s max=%d mismatches=%d first=(%d,%d) src=%d expected=%d actual=%d",
+                                          image_kind_name(kind), variant, width, height, block_size, delta, threshold_type == THRESH_BINARY ? "binary" : "binary_inv", max_value,
+                                          mismatches, location.x, location.y, image.at<unsigned char>(location), expected.at<unsigned char>(location), actual.at<unsigned char>(location));
+
+                                    ++failures;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("cases    : %ld\n", cases);
+    printf("failures : %ld\n", failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,972 @@
+//!
+//! @file  train_model.cc
+//! @brief ラベル付きのマス画像から SVMOCR, LinearOCR 用のバイナリモデルを学習するツール
+//!
+//! 特徴量は SVMOCR::compute_feature と同じものを使う。-pca を指定すると特徴量を主成分に射影してから学習し、
+//! 射影をモデルに含めて書き出す。カーネルは射影後の低次元の空間で評価されるため、認識が軽くなる。
+//!
+//! C, gamma に複数の値を与えると、その組み合わせを複数のスレッドで並列に学習し、検証用に取り分けたマス画像の認識精度で
+//! モデルを選ぶ。サポートベクタ数や認識時間の上限を与えた場合は、上限を満たすモデルの中で最も精度の高いものを選ぶ。
+//! 射影と gamma の既定値は、検証用のマス画像を含めずに求める。
+//! 選んだ C, gamma は、検証用に取り分けたマス画像も含めたすべてのマス画像で学習し直してから書き出す。
+//!
+//! -linear を指定すると、LinearOCR::compute_feature の縮小画像を特徴量として多項ロジスティック回帰を勾配降下法で学習し、
+//! LinearOCR 用の one-vs-rest の線形モデルを書き出す。取り分けたマス画像での精度を表示してから、すべてのマス画像で学習し直す。
+//!
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <svm.h>
+
+#include "CellCorpus.h"
+#include "debuglog.h"
+#include "digit_image.h"
+#include "LinearModel.h"
+#include "LinearOCR.h"
+#include "SVMModel.h"
+#include "SVMOCR.h"
+
+namespace
+{
+using namespace cv;
+using namespace std;
+using namespace videosudoku;
+
+constexpr auto latency_passes = 3; //!< 認識時間を計測する際に検証データを認識する回数
+
+constexpr auto linear_batch_size = 64;         //!< 線形モデルの勾配降下法のミニバッチの大きさ
+constexpr auto linear_learning_rate = 0.5;     //!< 線形モデルの学習率の初期値
+constexpr auto linear_weight_decay = 1e-4;     //!< 線形モデルの重みの L2 正則化の係数
+constexpr auto linear_pixel_scale = 1.0 / 255; //!< 線形モデルの学習時に画素値に掛ける係数
+
+//! @brief 学習の設定
+struct TrainingOptions
+{
+    int components = 0;                //!< 射影後の次元数 (0 の場合は射影しない)
+    int kernel_type = LINEAR;          //!< カーネルの種類
+    vector<double> c_values = {1.0};   //!< ペナルティ C の候補
+    vector<double> gamma_values = {0}; //!< カーネルパラメータ gamma の候補 (0 は特徴量の分散から決める既定値)
+    bool probability = true;           //!< 確率モデルを学習するかどうか
+    int max_sv = 0;                    //!< サポートベクタ数の上限 (0 の場合は制限しない)
+    double max_latency = 0;            //!< 1マスあたりの認識時間の上限 (us 0 の場合は制限しない)
+    double validation = 0.2;           //!< 検証用に取り分けるマス画像の割合 (候補が複数ある場合や上限がある場合に使う)
+    int threads = 0;                   //!< 学習に使うスレッド数 (0 の場合はコア数)
+    int linear_rc = 0;                 //!< LinearOCR 用の線形モデルの縮小画像の ROW, COL サイズ (0 の場合は SVMOCR 用のモデル)
+    int epochs = 30;                   //!< 線形モデルの学習で全マス画像を繰り返す回数
+};
+
+//! @brief 学習するパラメータの組と、その結果
+struct Candidate
+{
+    double c = 0;           //!< ペナルティ C
+    double gamma = 0;       //!< カーネルパラメータ gamma
+    SVMModel model;         //!< 学習したモデル
+    bool trained = false;   //!< 学習と変換に成功したかどうか
+    int correct = 0;        //!< 検証データの正解の数
+    double latency = 0;     //!< 1マスあたりの認識時間 (us)
+};
+
+//! @brief libsvm に渡す学習データ
+struct TrainingSet
+{
+    vector<vector<svm_node>> nodes; //!< サンプルごとの特徴量 (index -1 で終端)
+    vector<svm_node *> rows;        //!< nodes の各行の先頭
+    vector<double> labels;          //!< サンプルごとのラベル
+    svm_problem problem;            //!< libsvm の学習問題 (上の領域を参照する)
+};
+
+//! @brief 使い方を表示する
+//! @param program プログラム名
+void usage(const char *program)
+{
+    printf("usage: %s [-pca n] [-kernel linear|rbf] [-c C,...] [-gamma g,...] [-probability 0|1]\n", program);
+    printf("       [-max-sv n] [-max-latency us] [-validation fraction] [-threads n] <corpus directory | packed file> <binary model>\n");
+    printf("       %s -linear rc [-epochs n] [-validation fraction] <corpus directory | packed file> <linear model>\n", program);
+    printf("  -pca         : project the %d features onto n principal components (default: no projection)\n", DATA_SIZE);
+    printf("  -kernel      : kernel type (default: linear)\n");
+    printf("  -c           : penalty parameter C, comma separated values are searched (default: 1)\n");
+    printf("  -gamma       : kernel parameter gamma, comma separated values are searched (default: 1 / (dim * feature variance))\n");
+    printf("  -probability : train the probability model used by the candidate solver (default: 1)\n");
+    printf("  -max-sv      : upper limit of the number of support vectors (default: none)\n");
+    printf("  -max-latency : upper limit of the recognition time per cell in us (default: none)\n");
+    printf("  -validation  : fraction of the corpus held out to select the model (default: 0.2)\n");
+    printf("  -threads     : number of training threads (default: number of cores)\n");
+    printf("  -linear      : train a LinearOCR model on rc x rc reduced images by multinomial logistic regression\n");
+    printf("  -epochs      : number of passes over the corpus when training a linear model (default: 30)\n");
+}
+
+//! @brief  カンマ区切りの数値の並びを読む
+//! @param  text   カンマ区切りの数値
+//! @return 数値の並び
+vector<double> parse_values(const char *text)
+{
+    vector<double> values;
+
+    string item;
+
+    for(auto p = text;; ++p)
+    {
+        if(*p == ',' || *p == '\0')
+        {
+            if(!item.empty())
+            {
+                values.push_back(atof(item.c_str()));
+            }
+
+            item.clear();
+
+            if(*p == '\0') break;
+        }
+        else
+        {
+            item.push_back(*p);
+        }
+    }
+
+    return values;
+}
+
+//! @brief libsvm の進捗表示を抑える
+void quiet(const char *)
+{
+}
+
+//! @brief マス画像から特徴量を求める
+//! @param cells    マス画像
+//! @param features 特徴量 (マス画像の数 x DATA_SIZE CV_32F)
+void extract_features(const vector<LabeledCell> &cells, Mat &features)
+{
+    features.create(static_cast<int>(cells.size()), DATA_SIZE, CV_32F);
+
+    unsigned char data[DATA_SIZE];
+
+    Mat image;
+
+    for(auto i = 0u; i < cells.size(); ++i)
+    {
+        // compute_feature は引数の行列ヘッダを書き換えるため、毎回ヘッダを作り直す。
+        image = cells[i].image;
+
+        SVMOCR::compute_feature(image, find_digit_area(image), data);
+
+        auto row = features.ptr<float>(static_cast<int>(i));
+
+        for(auto j = 0; j < DATA_SIZE; ++j)
+        {
+            row[j] = data[j];
+        }
+    }
+}
+
+//! @brief 特徴量から指定した index の行を取り出す
+//! @param features 特徴量
+//! @param indices  取り出す行の index
+//! @param rows     取り出した行
+void select_rows(const Mat &features, const vector<int> &indices, Mat &rows)
+{
+    rows.create(static_cast<int>(indices.size()), features.cols, features.type());
+
+    for(auto i = 0u; i < indices.size(); ++i)
+    {
+        features.row(indices[i]).copyTo(rows.row(static_cast<int>(i)));
+    }
+}
+
+//! @brief 指定したマス画像の特徴量から主成分を求め、すべての特徴量を射影する
+//!
+//! 主成分への射影は x' = E (x - mean) なので、重みを E、定数項を -E mean としてモデルに含める。
+//! @param features   特徴量
+//! @param indices    主成分を求めるマス画像の index
+//! @param components 射影後の次元数 (0 の場合は射影しない)
+//! @param weights    射影行列 (射影しない場合は空)
+//! @param biases     射影後の定数項 (射影しない場合は空)
+//! @param projected  射影後の特徴量 (射影しない場合は features と同じ領域)
+void fit_projection(const Mat &features, const vector<int> &indices, const int components, Mat &weights, Mat &biases, Mat &projected)
+{
+    weights.release();
+    biases.release();
+
+    if(components <= 0)
+    {
+        projected = features;
+
+        return;
+    }
+
+    Mat fitting;
+
+    select_rows(features, indices, fitting);
+
+    const PCA pca(fitting, noArray(), PCA::DATA_AS_ROW, components);
+
+    pca.eigenvectors.convertTo(weights, CV_64F);
+
+    Mat mean_value;
+
+    pca.mean.convertTo(mean_value, CV_64F);
+
+    biases = weights * mean_value.t();
+    biases = biases * -1.0;
+
+    projected = pca.project(features);
+}
+
+//! @brief  特徴量の分散から gamma の既定値を求める
+//! @param  features 特徴量
+//! @return gamma
+double default_gamma(const Mat &features)
+{
+    Scalar mean_value, stddev_value;
+
+    meanStdDev(features.reshape(1, 1), mean_value, stddev_value);
+
+    const auto variance = stddev_value[0] * stddev_value[0];
+
+    return variance > 0 ? 1.0 / (features.cols * variance) : 1.0 / features.cols;
+}
+
+//! @brief 特徴量を libsvm の学習データに変換する
+//! @param features 特徴量
+//! @param cells    マス画像 (ラベルを使う)
+//! @param indices  学習に使うマス画像の index
+//! @param set      学習データ
+void make_training_set(const Mat &features, const vector<LabeledCell> &cells, const vector<int> &indices, TrainingSet &set)
+{
+    const auto count = indices.size();
+
+    set.nodes.assign(count, {});
+    set.rows.resize(count);
+    set.labels.resize(count);
+
+    for(auto i = 0u; i < count; ++i)
+    {
+        const auto row = features.ptr<float>(indices[i]);
+
+        auto &node = set.nodes[i];
+
+        for(auto j = 0; j < features.cols; ++j)
+        {
+            if(row[j] != 0)
+            {
+                node.push_back({j + 1, row[j]});
+            }
+        }
+
+        node.push_back({-1, 0});
+
+        set.rows[i] = node.data();
+        set.labels[i] = cells[static_cast<size_t>(indices[i])].label;
+    }
+
+    set.problem.l = static_cast<int>(count);
+    set.problem.y = set.labels.data();
+    set.problem.x = set.rows.data();
+}
+
+//! @brief 変換したモデルでマス画像を認識して、正解の数と1マスあたりの認識時間を求める
+//! @param model    変換したモデル
+//! @param features 射影前の特徴量
+//! @param cells    マス画像 (ラベルを使う)
+//! @param indices  認識するマス画像の index
+//! @param passes   認識を繰り返す回数 (認識時間の計測に使う)
+//! @param correct  正解の数
+//! @param latency  1マスあたりの認識時間 (us)
+void evaluate(const SVMModel &model, const Mat &features, const vector<LabeledCell> &cells, const vector<int> &indices, const int passes, int &correct, double &latency)
+{
+    vector<float> input(static_cast<size_t>(model.get_input_stride()), 0.0f);
+    vector<float> x(static_cast<size_t>(model.get_stride()), 0.0f);
+    vector<double> kvalue(static_cast<size_t>(model.get_total_sv()));
+    vector<double> dec_values(static_cast<size_t>(model.get_nr_class() * (model.get_nr_class() - 1) / 2));
+
+    correct = 0;
+
+    const auto begin = chrono::steady_clock::now();
+
+    for(auto pass = 0; pass < passes; ++pass)
+    {
+        for(const auto index: indices)
+        {
+            copy(features.ptr<float>(index), features.ptr<float>(index) + features.cols, input.begin());
+
+            // SVMOCR::predict と同じく、射影を持つモデルは射影してからカーネルを評価する。
+            if(model.has_projection())
+            {
+                model.project(input.data(), x.data());
+            }
+            else
+            {
+                copy(input.begin(), input.end(), x.begin());
+            }
+
+            const auto label = model.predict_values(x.data(), kvalue.data(), dec_values.data());
+
+            if(pass == 0 && label == cells[static_cast<size_t>(index)].label)
+            {
+                ++correct;
+            }
+        }
+    }
+
+    const auto elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+
+    latency = indices.empty() ? 0 : elapsed / (static_cast<double>(indices.size()) * passes);
+}
+
+//! @brief  1組のパラメータで学習して、SVMModel に変換する
+//! @param  set       学習データ
+//! @param  parameter libsvm のパラメータ
+//! @param  dim       特徴量の次元数
+//! @param  weights   射影行列 (射影しない場合は空)
+//! @param  biases    射影後の定数項 (射影しない場合は空)
+//! @param  model     変換したモデル
+//! @retval true      成功
+//! @retval false     失敗
+bool train(const TrainingSet &set, const svm_parameter &parameter, const int dim, const Mat &weights, const Mat &biases, SVMModel &model)
+{
+    auto text_model = svm_train(&set.problem, &parameter);
+
+    if(!text_model) return false;
+
+    const auto assigned = weights.empty()
+        ? model.assign(text_model, dim)
+        : model.assign(text_model, dim, DATA_SIZE, weights.ptr<double>(), biases.ptr<double>());
+
+    svm_free_and_destroy_model(&text_model);
+
+    return assigned;
+}
+
+//! @brief LinearOCR の特徴量を求める
+//! @param cells    マス画像
+//! @param image_rc 縮小画像の ROW, COL サイズ
+//! @param features 特徴量 (マス画像の数 x image_rc * image_rc CV_32F)
+void extract_linear_features(const vector<LabeledCell> &cells, const int image_rc, Mat &features)
+{
+    features.create(static_cast<int>(cells.size()), image_rc * image_rc, CV_32F);
+
+    Mat image;
+
+    for(auto i = 0u; i < cells.size(); ++i)
+    {
+        image = cells[i].image;
+
+        LinearOCR::compute_feature(image, find_digit_area(image), image_rc, features.ptr<float>(static_cast<int>(i)));
+    }
+}
+
+//! @brief 多項ロジスティック回帰をミニバッチの勾配降下法で学習する
+//!
+//! 画素値は学習用のマス画像の平均を引いて linear_pixel_scale を掛けてから学習し、
+//! 学習後に重みと定数項へ畳み込んで、compute_feature の値をそのまま入力できるようにする。
+//! @param features  特徴量
+//! @param classes   マス画像ごとのクラスの番号 (0 - nr_class - 1)
+//! @param indices   学習に使うマス画像の index
+//! @param nr_class  クラス数
+//! @param epochs    全マス画像を繰り返す回数
+//! @param weights   重み (nr_class * 特徴量の次元数)
+//! @param biases    定数項 (nr_class)
+void fit_softmax(const Mat &features, const vector<int> &classes, const vector<int> &indices, const int nr_class, const int epochs, vector<double> &weights, vector<double> &biases)
+{
+    const auto dim = static_cast<size_t>(features.cols);
+    const auto nr_function = static_cast<size_t>(nr_class);
+
+    vector<double> mean(dim, 0.0);
+
+    for(const auto index: indices)
+    {
+        const auto row = features.ptr<float>(index);
+
+        for(auto j = 0u; j < dim; ++j)
+        {
+            mean[j] += row[j] * linear_pixel_scale;
+        }
+    }
+
+    for(auto &value: mean)
+    {
+        value /= static_cast<double>(max<size_t>(indices.size(), 1));
+    }
+
+    vector<double> w(nr_function * dim, 0.0), b(nr_function, 0.0);
+    vector<double> w_gradient(w.size()), b_gradient(b.size());
+    vector<double> x(dim), p(nr_function);
+
+    vector<int> order = indices;
+
+    mt19937 random(1);
+
+    for(auto epoch = 0; epoch < epochs; ++epoch)
+    {
+        shuffle(order.begin(), order.end(), random);
+
+        // 後半の繰り返しほど学習率を下げて収束させる。
+        const auto rate = linear_learning_rate / (1.0 + 4.0 * epoch / max(epochs, 1));
+
+        for(auto begin = 0u; begin < order.size(); begin += linear_batch_size)
+        {
+            const auto end = min(order.size(), static_cast<size_t>(begin + linear_batch_size));
+
+            fill(w_gradient.begin(), w_gradient.end(), 0.0);
+            fill(b_gradient.begin(), b_gradient.end(), 0.0);
+
+            for(auto i = begin; i < end; ++i)
+            {
+                const auto index = order[i];
+                const auto row = features.ptr<float>(index);
+
+                for(auto j = 0u; j < dim; ++j)
+                {
+                    x[j] = row[j] * linear_pixel_scale - mean[j];
+                }
+
+                // ソフトマックスの確率から正解の指示関数を引いたものが、スコアについての交差エントロピーの勾配になる。
+                auto max_score = -numeric_limits<double>::infinity();
+
+                for(auto k = 0u; k < nr_function; ++k)
+                {
+                    p[k] = inner_product(x.begin(), x.end(), w.begin() + static_cast<ptrdiff_t>(k * dim), b[k]);
+                    max_score = max(max_score, p[k]);
+                }
+
+                auto sum = 0.0;
+
+                for(auto &value: p)
+                {
+                    value = exp(value - max_score);
+                    sum += value;
+                }
+
+                for(auto k = 0u; k < nr_function; ++k)
+                {
+                    const auto error = p[k] / sum - (static_cast<int>(k) == classes[static_cast<size_t>(index)] ? 1.0 : 0.0);
+
+                    auto gradient = w_gradient.begin() + static_cast<ptrdiff_t>(k * dim);
+
+                    for(auto j = 0u; j < dim; ++j)
+                    {
+                        gradient[static_cast<ptrdiff_t>(j)] += error * x[j];
+                    }
+
+                    b_gradient[k] += error;
+                }
+            }
+
+            const auto scale = rate / static_cast<double>(end - begin);
+
+            for(auto j = 0u; j < w.size(); ++j)
+            {
+                w[j] -= scale * w_gradient[j] + rate * linear_weight_decay * w[j];
+            }
+
+            for(auto k = 0u; k < nr_function; ++k)
+            {
+                b[k] -= scale * b_gradient[k];
+            }
+        }
+    }
+
+    // w・(s x - mean) + b = (s w)・x + (b - w・mean) として、縮小画像の画素値を直接受け取る形にする。
+    weights.resize(w.size());
+    biases.resize(b.size());
+
+    for(auto k = 0u; k < nr_function; ++k)
+    {
+        const auto row = w.begin() + static_cast<ptrdiff_t>(k * dim);
+
+        for(auto j = 0u; j < dim; ++j)
+        {
+            weights[k * dim + j] = row[static_cast<ptrdiff_t>(j)] * linear_pixel_scale;
+        }
+
+        biases[k] = b[k] - inner_product(mean.begin(), mean.end(), row, 0.0);
+    }
+}
+
+//! @brief  線形モデルでマス画像を認識して、正解の数を求める
+//! @param  model    線形モデル
+//! @param  features 特徴量
+//! @param  cells    マス画像 (ラベルを使う)
+//! @param  indices  認識するマス画像の index
+//! @return 正解の数
+int evaluate_linear(const LinearModel &model, const Mat &features, const vector<LabeledCell> &cells, const vector<int> &indices)
+{
+    vector<float> x(static_cast<size_t>(model.get_stride()), 0.0f);
+    vector<float> scores(static_cast<size_t>(model.get_nr_function()));
+
+    auto correct = 0;
+
+    for(const auto index: indices)
+    {
+        copy(features.ptr<float>(index), features.ptr<float>(index) + features.cols, x.begin());
+
+        if(model.predict(x.data(), scores.data()) == cells[static_cast<size_t>(index)].label)
+        {
+            ++correct;
+        }
+    }
+
+    return correct;
+}
+
+//! @brief  LinearOCR 用の線形モデルを学習して書き出す
+//! @param  cells      マス画像
+//! @param  options    学習の設定
+//! @param  model_file 出力ファイル
+//! @retval 0          成功
+//! @retval 1          失敗
+int train_linear(const vector<LabeledCell> &cells, const TrainingOptions &options, const char *model_file)
+{
+    vector<int> labels;
+
+    for(const auto &cell: cells)
+    {
+        labels.push_back(cell.label);
+    }
+
+    sort(labels.begin(), labels.end());
+    labels.erase(unique(labels.begin(), labels.end()), labels.end());
+
+    const auto nr_class = static_cast<int>(labels.size());
+
+    if(nr_class < 2 || nr_class > LINEAR_MAX_CLASS)
+    {
+        ERROR("The corpus must have between 2 and %d labels. : %d", LINEAR_MAX_CLASS, nr_class);
+
+        return 1;
+    }
+
+    vector<int> classes(cells.size());
+
+    for(auto i = 0u; i < cells.size(); ++i)
+    {
+        classes[i] = static_cast<int>(lower_bound(labels.begin(), labels.end(), cells[i].label) - labels.begin());
+    }
+
+    Mat features;
+
+    extract_linear_features(cells, options.linear_rc, features);
+
+    const auto interval = options.validation > 0 ? max(2, static_cast<int>(1.0 / options.validation + 0.5)) : 0;
+
+    vector<int> training_indices, validation_indices, all_indices(cells.size());
+
+    iota(all_indices.begin(), all_indices.end(), 0);
+
+    for(const auto i: all_indices)
+    {
+        if(interval > 0 && i % interval == 0)
+        {
+            validation_indices.push_back(i);
+        }
+        else
+        {
+            training_indices.push_back(i);
+        }
+    }
+
+    vector<double> weights, biases;
+
+    LinearModel model;
+
+    // 取り分けたマス画像で精度を確かめてから、すべてのマス画像で学習し直して書き出す。
+    if(!validation_indices.empty() && !training_indices.empty())
+    {
+        fit_softmax(features, classes, training_indices, nr_class, options.epochs, weights, biases);
+
+        if(!model.assign(LINEAR_ONE_VS_REST, nr_class, labels.data(), options.linear_rc, weights.data(), biases.data()))
+        {
+            ERROR("The linear model wasn't able to be created.");
+
+            return 1;
+        }
+
+        const auto held_out = evaluate_linear(model, features, cells, validation_indices);
+        const auto training = evaluate_linear(model, features, cells, training_indices);
+
+        printf("%zu training cells : training accuracy %.4f, held-out accuracy %.4f (%d/%zu)\n", training_indices.size(),
+               static_cast<double>(training) / static_cast<double>(training_indices.size()),
+               static_cast<double>(held_out) / static_cast<double>(validation_indices.size()), held_out, validation_indices.size());
+    }
+
+    fit_softmax(features, classes, all_indices, nr_class, options.epochs, weights, biases);
+
+    if(!model.assign(LINEAR_ONE_VS_REST, nr_class, labels.data(), options.linear_rc, weights.data(), biases.data()) || !model.save(model_file))
+    {
+        ERROR("The linear model wasn't able to be written. : %s", model_file);
+
+        return 1;
+    }
+
+    const auto correct = evaluate_linear(model, features, cells, all_indices);
+
+    printf("saved : %dx%d, trained on all %zu cells, training accuracy %.4f\n", options.linear_rc, options.linear_rc, cells.size(),
+           static_cast<double>(correct) / static_cast<double>(cells.size()));
+
+    return 0;
+}
+
+//! @brief  上限を満たす候補の中から、精度が最も高く、同じ精度ならサポートベクタの少ないものを選ぶ
+//! @param  candidates 学習した候補
+//! @param  options    学習の設定
+//! @retval -1         上限を満たす候補が無い
+//! @return others     選んだ候補の index
+int select_candidate(const vector<unique_ptr<Candidate>> &candidates, const TrainingOptions &options)
+{
+    auto selected = -1;
+
+    for(auto i = 0; i < static_cast<int>(candidates.size()); ++i)
+    {
+        const auto &candidate = *candidates[static_cast<size_t>(i)];
+
+        if(!candidate.trained) continue;
+        if(options.max_sv > 0 && candidate.model.get_total_sv() > options.max_sv) continue;
+        if(options.max_latency > 0 && candidate.latency > options.max_latency) continue;
+
+        if(selected < 0)
+        {
+            selected = i;
+
+            continue;
+        }
+
+        const auto &best = *candidates[static_cast<size_t>(selected)];
+
+        if(candidate.correct > best.correct || (candidate.correct == best.correct && candidate.model.get_total_sv() < best.model.get_total_sv()))
+        {
+            selected = i;
+        }
+    }
+
+    return selected;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    TrainingOptions options;
+
+    const char *corpus_path = nullptr;
+    const char *model_file = nullptr;
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-pca") == 0 && i + 1 < argc)
+        {
+            options.components = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-kernel") == 0 && i + 1 < argc)
+        {
+            options.kernel_type = strcmp(argv[++i], "rbf") == 0 ? RBF : LINEAR;
+        }
+        else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            options.c_values = parse_values(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-gamma") == 0 && i + 1 < argc)
+        {
+            options.gamma_values = parse_values(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-probability") == 0 && i + 1 < argc)
+        {
+            options.probability = atoi(argv[++i]) != 0;
+        }
+        else if(strcmp(argv[i], "-max-sv") == 0 && i + 1 < argc)
+        {
+            options.max_sv = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-max-latency") == 0 && i + 1 < argc)
+        {
+            options.max_latency = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-validation") == 0 && i + 1 < argc)
+        {
+            options.validation = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            options.threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-linear") == 0 && i + 1 < argc)
+        {
+            options.linear_rc = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-epochs") == 0 && i + 1 < argc)
+        {
+            options.epochs = atoi(argv[++i]);
+        }
+        else if(!corpus_path)
+        {
+            corpus_path = argv[i];
+        }
+        else
+        {
+            model_file = argv[i];
+        }
+    }
+
+    if(!corpus_path || !model_file || options.components < 0 || options.components > DATA_SIZE ||
+       options.c_values.empty() || options.gamma_values.empty() || options.validation < 0 || options.validation >= 1 ||
+       options.linear_rc < 0 || options.epochs <= 0)
+    {
+        usage(argv[0]);
+
+        return 1;
+    }
+
+    // 線形カーネルは gamma を使わないため、gamma の候補で同じ学習を繰り返さない。
+    if(options.kernel_type == LINEAR)
+    {
+        options.gamma_values = {0};
+    }
+
+    CellCorpus corpus;
+
+    if(!corpus.load(corpus_path))
+    {
+        ERROR("The corpus wasn't able to be loaded. : %s", corpus_path);
+
+        return 1;
+    }
+
+    const auto &cells = corpus.get_cells();
+
+    if(options.linear_rc > 0)
+    {
+        return train_linear(cells, options, model_file);
+    }
+
+    Mat features;
+
+    extract_features(cells, features);
+
+    // 候補が1つで上限も無い場合は、すべてのマス画像で学習する。
+    // そうでなければ一定の間隔でマス画像を取り分け、その認識精度と認識時間で候補を比べる。
+    const auto searching = options.c_values.size() * options.gamma_values.size() > 1 || options.max_sv > 0 || options.max_latency > 0;
+    const auto interval = searching && options.validation > 0 ? max(2, static_cast<int>(1.0 / options.validation + 0.5)) : 0;
+
+    vector<int> training_indices, validation_indices;
+
+    for(auto i = 0; i < static_cast<int>(cells.size()); ++i)
+    {
+        if(interval > 0 && i % interval == 0)
+        {
+            validation_indices.push_back(i);
+        }
+        else
+        {
+            training_indices.push_back(i);
+        }
+    }
+
+    const auto held_out = !validation_indices.empty();
+
+    if(!held_out)
+    {
+        validation_indices = training_indices;
+    }
+
+    // 検証の精度が甘くならないように、射影と gamma の既定値は学習用のマス画像だけから求める。
+    Mat projected, weights, biases;
+
+    fit_projection(features, training_indices, options.components, weights, biases, projected);
+
+    Mat training_projected;
+
+    select_rows(projected, training_indices, training_projected);
+
+    const auto dim = projected.cols;
+
+    TrainingSet set;
+
+    make_training_set(projected, cells, training_indices, set);
+
+    svm_parameter parameter;
+
+    memset(&parameter, 0, sizeof(parameter));
+
+    parameter.svm_type = C_SVC;
+    parameter.kernel_type = options.kernel_type;
+    parameter.degree = 3;
+    parameter.gamma = default_gamma(training_projected);
+    parameter.cache_size = 200;
+    parameter.eps = 1e-3;
+    parameter.C = options.c_values.front();
+    parameter.nu = 0.5;
+    parameter.p = 0.1;
+    parameter.shrinking = 1;
+    parameter.probability = options.probability ? 1 : 0;
+
+    const auto parameter_error = svm_check_parameter(&set.problem, &parameter);
+
+    if(parameter_error)
+    {
+        ERROR("Invalid parameter. : %s", parameter_error);
+
+        return 1;
+    }
+
+    svm_set_print_string_function(quiet);
+
+    vector<unique_ptr<Candidate>> candidates;
+
+    for(const auto c: options.c_values)
+    {
+        for(const auto gamma: options.gamma_values)
+        {
+            candidates.emplace_back(new Candidate());
+            candidates.back()->c = c;
+            candidates.back()->gamma = gamma > 0 ? gamma : parameter.gamma;
+        }
+    }
+
+    // 候補ごとの学習は互いに独立しているため、スレッドごとに次の候補を取って学習する。
+    const auto hardware_threads = static_cast<int>(thread::hardware_concurrency());
+    const auto thread_count = min(static_cast<int>(candidates.size()), max(1, options.threads > 0 ? options.threads : hardware_threads));
+
+    atomic<int> next(0);
+
+    auto worker = [&]()
+    {
+        for(auto index = next++; index < static_cast<int>(candidates.size()); index = next++)
+        {
+            auto &candidate = *candidates[static_cast<size_t>(index)];
+
+            auto candidate_parameter = parameter;
+
+            candidate_parameter.C = candidate.c;
+            candidate_parameter.gamma = candidate.gamma;
+
+            candidate.trained = train(set, candidate_parameter, dim, weights, biases, candidate.model);
+
+            if(candidate.trained)
+            {
+                double latency;
+
+                evaluate(candidate.model, features, cells, validation_indices, 1, candidate.correct, latency);
+            }
+        }
+    };
+
+    vector<thread> workers;
+
+    for(auto i = 0; i < thread_count; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    for(auto &running: workers)
+    {
+        running.join();
+    }
+
+    // 並列に学習している間の計測は他のスレッドの影響を受けるため、認識時間は学習を終えてから1つずつ計測する。
+    printf("%12s %12s %8s %10s %12s\n", "C", "gamma", "SVs", "accuracy", "latency(us)");
+
+    for(auto &candidate: candidates)
+    {
+        if(!candidate->trained)
+        {
+            printf("%12g %12g %8s\n", candidate->c, candidate->gamma, "failed");
+
+            continue;
+        }
+
+        int correct;
+
+        evaluate(candidate->model, features, cells, validation_indices, latency_passes, correct, candidate->latency);
+
+        printf("%12g %12g %8d %10.4f %12.1f\n", candidate->c, candidate->gamma, candidate->model.get_total_sv(),
+               static_cast<double>(candidate->correct) / static_cast<double>(validation_indices.size()), candidate->latency);
+    }
+
+    const auto selected = select_candidate(candidates, options);
+
+    if(selected < 0)
+    {
+        ERROR("No model satisfies the budget.");
+
+        return 1;
+    }
+
+    const auto &chosen = *candidates[static_cast<size_t>(selected)];
+
+    const SVMModel *best = &chosen.model;
+
+    auto trained_cells = training_indices.size();
+
+    // 選んだ C, gamma で、検証用に取り分けたマス画像も含めて学習し直す。
+    // 学習し直したモデルはサポートベクタが増えるため、上限を超える場合は選んだモデルをそのまま書き出す。
+    SVMModel full_model;
+
+    if(held_out)
+    {
+        vector<int> all_indices(cells.size());
+
+        iota(all_indices.begin(), all_indices.end(), 0);
+
+        fit_projection(features, all_indices, options.components, weights, biases, projected);
+
+        TrainingSet full_set;
+
+        make_training_set(projected, cells, all_indices, full_set);
+
+        auto full_parameter = parameter;
+
+        full_parameter.C = chosen.c;
+        full_parameter.gamma = chosen.gamma;
+
+        if(train(full_set, full_parameter, projected.cols, weights, biases, full_model))
+        {
+            int correct;
+            double latency;
+
+            evaluate(full_model, features, cells, validation_indices, latency_passes, correct, latency);
+
+            if((options.max_sv <= 0 || full_model.get_total_sv() <= options.max_sv) && (options.max_latency <= 0 || latency <= options.max_latency))
+            {
+                best = &full_model;
+                trained_cells = cells.size();
+            }
+            else
+            {
+                printf("The model retrained on all %zu cells exceeds the budget (SVs %d, latency %.1f us).\n", cells.size(), full_model.get_total_sv(), latency);
+            }
+        }
+        else
+        {
+            printf("The model wasn't able to be retrained on all %zu cells.\n", cells.size());
+        }
+    }
+
+    // 精度は取り分けたマス画像で選んだモデルを評価したもので、学習し直したモデルの精度の推定値になる。
+    printf("saved : C %g, gamma %g, SVs %d, trained on %zu of %zu cells, %s accuracy %.4f\n", chosen.c, chosen.gamma, best->get_total_sv(),
+           trained_cells, cells.size(), held_out ? "held-out" : "training", static_cast<double>(chosen.correct) / static_cast<double>(validation_indices.size()));
+
+    SVMModel saved;
+
+    if(!best->save(model_file) || !saved.load(model_file))
+    {
+        ERROR("The binary model wasn't able to be written. : %s", model_file);
+
+        return 1;
+    }
+
+    LOG("%s -> %s (cells %zu, trained on %zu, dim %d, C %g, gamma %g, total_sv %d)",
+        corpus_path, model_file, cells.size(), trained_cells, saved.get_dim(), chosen.c, chosen.gamma, saved.get_total_sv());
+
+    return 0;
+}